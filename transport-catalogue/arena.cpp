@@ -0,0 +1,51 @@
+#include "arena.h"
+
+#include <cstring>
+
+namespace transport {
+
+Arena::Arena(size_t initial_size)
+    : buffer_(initial_size, &upstream_) {
+}
+
+std::string_view Arena::StoreString(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    char* data = AllocateArray<char>(str.size());
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+AllocationStats Arena::GetStats() const {
+    return {allocations_, bytes_, upstream_.allocations, upstream_.bytes};
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    ++allocations_;
+    bytes_ += bytes;
+    return buffer_.allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t, size_t) {
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void* Arena::CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    ++allocations;
+    this->bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Arena::CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Arena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace transport
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+
+namespace transport {
+
+    struct AllocationStats {
+        // Запросы, обслуженные ареной
+        size_t allocations = 0;
+        size_t bytes = 0;
+        // Блоки, полученные ареной у системного распределителя
+        size_t upstream_allocations = 0;
+        size_t upstream_bytes = 0;
+    };
+
+    /*
+     * Монотонная арена для данных каталога: имён, массивов остановок маршрутов
+     * и узлов индексов. Освобождение отдельных объектов ничего не делает,
+     * вся память возвращается системе разом при уничтожении арены. То, что
+     * освобождается и выделяется повторно, каталог берёт через пул поверх арены.
+     */
+    class Arena final : public std::pmr::memory_resource {
+    public:
+        explicit Arena(size_t initial_size = 64 * 1024);
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Копирует строку в арену; результат живёт столько же, сколько арена
+        std::string_view StoreString(std::string_view str);
+
+        template <typename T>
+        T* AllocateArray(size_t count) {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        [[nodiscard]] AllocationStats GetStats() const;
+
+    private:
+        class CountingResource final : public std::pmr::memory_resource {
+        public:
+            size_t allocations = 0;
+            size_t bytes = 0;
+
+        private:
+            void* do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        CountingResource upstream_;
+        std::pmr::monotonic_buffer_resource buffer_;
+        size_t allocations_ = 0;
+        size_t bytes_ = 0;
+    };
+
+} // namespace transport
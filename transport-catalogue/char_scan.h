@@ -0,0 +1,61 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Поиск служебных символов в длинных строках: парсер JSON и экранирование
+ * при выводе пропускают обычные символы целыми блоками.
+ * Набор инструкций выбирается при компиляции: AVX2 (-mavx2), SSE2 (есть
+ * на любом x86-64) или побайтовый цикл на остальных платформах
+ */
+namespace scan {
+
+    namespace detail {
+
+        template <char... Chars>
+        constexpr bool IsOneOf(char c) {
+            return ((c == Chars) || ...);
+        }
+
+    } // namespace detail
+
+    // Позиция первого из символов Chars в str не раньше pos, либо str.size()
+    template <char... Chars>
+    size_t FindFirstOf(std::string_view str, size_t pos = 0) {
+        const char* data = str.data();
+        const size_t size = str.size();
+#if defined(__AVX2__)
+        for (; pos + 32 <= size; pos += 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            __m256i hits = _mm256_setzero_si256();
+            ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(Chars)))), ...);
+            if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)); mask != 0) {
+                return pos + std::countr_zero(mask);
+            }
+        }
+#endif
+#if defined(__SSE2__)
+        for (; pos + 16 <= size; pos += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            __m128i hits = _mm_setzero_si128();
+            ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Chars)))), ...);
+            if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits)); mask != 0) {
+                return pos + std::countr_zero(mask);
+            }
+        }
+#endif
+        while (pos < size && !detail::IsOneOf<Chars...>(data[pos])) {
+            ++pos;
+        }
+        return pos;
+    }
+
+} // namespace scan
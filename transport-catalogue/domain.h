@@ -2,20 +2,25 @@
 
 #include "geo.h"
 
-#include <string>
-#include <vector>
+#include <span>
+#include <string_view>
+#include <utility>
 
 namespace transport {
 
+    // Имена и массивы остановок размещаются в арене TransportCatalogue
     struct Stop {
-        std::string name;
+        std::string_view name;
         geo::Coordinates coordinates;
+        // Удалена delta-запросом: объект остался в хранилище каталога, но в расчётах не участвует
+        bool retired = false;
     };
 
     struct Bus {
-        std::string name;
-        std::vector<const Stop*> stops;
+        std::string_view name;
+        std::span<const Stop* const> stops;
         bool is_roundtrip = false;
+        bool retired = false;
     };
 
     class StopPairHasher {
@@ -1,6 +1,12 @@
 #include "json.h"
+#include "char_scan.h"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <iterator>
+#include <limits>
+#include <string_view>
 
 namespace json {
 
@@ -222,133 +228,767 @@ Node LoadNode(std::istream& input) {
     }
 }
 
-struct PrintContext {
-    std::ostream& out;
-    int indent_step = 4;
-    int indent = 0;
+// Разбор JSON из непрерывного буфера. Повторяет поведение потоковых функций выше,
+// но работает указателями по памяти и не выделяет временных строк для чисел.
+// Результат разбора передаётся обработчику событий Sink
+template <typename Sink>
+class BufferParser {
+public:
+    BufferParser(std::string_view input, Sink& sink)
+        : pos_(input.data())
+        , end_(input.data() + input.size())
+        , sink_(sink) {
+    }
 
-    void PrintIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+    void ParseValue() {
+        SkipSpaces();
+        if (pos_ == end_) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (*pos_) {
+            case '[':
+                ++pos_;
+                ParseArray();
+                break;
+            case '{':
+                ++pos_;
+                ParseDict();
+                break;
+            case '"':
+                ++pos_;
+                sink_.String(ParseString());
+                break;
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                ParseBool();
+                break;
+            case 'n':
+                ParseNull();
+                break;
+            default:
+                ParseNumber();
+                break;
         }
     }
 
-    PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+private:
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
     }
-};
 
-void PrintNode(const Node& value, const PrintContext& ctx);
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
-}
+    static bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
-    for (const char c : value) {
-        switch (c) {
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
+    void SkipSpaces() {
+        while (pos_ != end_ && IsSpace(*pos_)) {
+            ++pos_;
+        }
+    }
+
+    // Возвращает следующий непробельный символ, как input >> c
+    bool NextChar(char& c) {
+        SkipSpaces();
+        if (pos_ == end_) {
+            return false;
+        }
+        c = *pos_++;
+        return true;
+    }
+
+    void ParseArray() {
+        sink_.StartArray();
+        char c = '\0';
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == ']') {
+                closed = true;
                 break;
-            case '\t':
-                out << "\\t"sv;
+            }
+            if (c != ',') {
+                --pos_;
+            }
+            ParseValue();
+        }
+        if (!closed) {
+            throw ParsingError("Array parsing error"s);
+        }
+        sink_.EndArray();
+    }
+
+    void ParseDict() {
+        sink_.StartDict();
+        char c = '\0';
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == '}') {
+                closed = true;
                 break;
-            case '"':
-                // Символы " и \ выводятся как \" или \\, соответственно
-                [[fallthrough]];
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
+            }
+            if (c == '"') {
+                const std::string_view key = ParseString();
+                if (NextChar(c) && c == ':') {
+                    sink_.Key(key);
+                    ParseValue();
+                } else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!closed) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        sink_.EndDict();
+    }
+
+    // Пропускает символы, не требующие особой обработки внутри строки
+    std::string_view ScanPlain() {
+        const std::string_view rest(pos_, static_cast<size_t>(end_ - pos_));
+        const size_t length = scan::FindFirstOf<'"', '\\', '\n', '\r'>(rest);
+        pos_ += length;
+        return rest.substr(0, length);
+    }
+
+    // Строка без escape-последовательностей возвращается как срез входного буфера,
+    // иначе она собирается во внутреннем буфере парсера
+    std::string_view ParseString() {
+        const std::string_view plain = ScanPlain();
+        if (pos_ != end_ && *pos_ == '"') {
+            ++pos_;
+            return plain;
+        }
+        scratch_.assign(plain);
+        while (true) {
+            if (pos_ == end_) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *pos_;
+            if (ch == '"') {
+                ++pos_;
                 break;
+            } else if (ch == '\\') {
+                ++pos_;
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_++;
+                switch (escaped_char) {
+                    case 'n':
+                        scratch_.push_back('\n');
+                        break;
+                    case 't':
+                        scratch_.push_back('\t');
+                        break;
+                    case 'r':
+                        scratch_.push_back('\r');
+                        break;
+                    case '"':
+                        scratch_.push_back('"');
+                        break;
+                    case '\\':
+                        scratch_.push_back('\\');
+                        break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            } else {
+                scratch_.append(ScanPlain());
+            }
+        }
+        return scratch_;
+    }
+
+    std::string_view ParseLiteral() {
+        const char* start = pos_;
+        while (pos_ != end_ && IsAlpha(*pos_)) {
+            ++pos_;
+        }
+        return {start, static_cast<size_t>(pos_ - start)};
+    }
+
+    void ParseBool() {
+        const auto s = ParseLiteral();
+        if (s == "true"sv) {
+            sink_.Bool(true);
+        } else if (s == "false"sv) {
+            sink_.Bool(false);
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+        }
+    }
+
+    void ParseNull() {
+        if (auto literal = ParseLiteral(); literal == "null"sv) {
+            sink_.Null();
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
         }
     }
-    out.put('"');
+
+    void ParseDigits() {
+        if (pos_ == end_ || !IsDigit(*pos_)) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (pos_ != end_ && IsDigit(*pos_)) {
+            ++pos_;
+        }
+    }
+
+    void ParseNumber() {
+        const char* start = pos_;
+        if (*pos_ == '-') {
+            ++pos_;
+        }
+        // После 0 в JSON не могут идти другие цифры
+        if (pos_ != end_ && *pos_ == '0') {
+            ++pos_;
+        } else {
+            ParseDigits();
+        }
+
+        bool is_int = true;
+        if (pos_ != end_ && *pos_ == '.') {
+            ++pos_;
+            ParseDigits();
+            is_int = false;
+        }
+        if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+            ++pos_;
+            if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+            }
+            ParseDigits();
+            is_int = false;
+        }
+
+        if (is_int) {
+            int value;
+            // При переполнении int число читается как double
+            if (auto [ptr, ec] = std::from_chars(start, pos_, value); ec == std::errc{} && ptr == pos_) {
+                sink_.Int(value);
+                return;
+            }
+        }
+        double value;
+        if (auto [ptr, ec] = std::from_chars(start, pos_, value); ec == std::errc{} && ptr == pos_) {
+            sink_.Double(value);
+            return;
+        }
+        throw ParsingError("Failed to convert "s + std::string(start, pos_) + " to number"s);
+    }
+
+    const char* pos_;
+    const char* end_;
+    Sink& sink_;
+    std::string scratch_;
+};
+
+// Проходит по тексту JSON, различая только строки, скобки и разделители.
+// Значения не проверяются: это делает полный разбор найденных фрагментов
+class StructureScanner {
+public:
+    explicit StructureScanner(std::string_view text)
+        : text_(text) {
+    }
+
+    size_t GetPos() const {
+        return pos_;
+    }
+
+    void SkipSpaces() {
+        while (pos_ < text_.size() && IsSpace(text_[pos_])) {
+            ++pos_;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipSpaces();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool AtQuote() {
+        SkipSpaces();
+        return pos_ < text_.size() && text_[pos_] == '"';
+    }
+
+    // Пропускает строку, стоящую в текущей позиции; false, если строка не закрыта
+    bool SkipString() {
+        ++pos_;
+        while (true) {
+            pos_ = scan::FindFirstOf<'"', '\\'>(text_, pos_);
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            if (text_[pos_] == '"') {
+                ++pos_;
+                return true;
+            }
+            pos_ += 2;
+        }
+    }
+
+    // Пропускает значение вместе с вложенными контейнерами
+    bool SkipValue() {
+        SkipSpaces();
+        if (pos_ == text_.size()) {
+            return false;
+        }
+        const char c = text_[pos_];
+        if (c == '"') {
+            return SkipString();
+        }
+        if (c == '[' || c == '{') {
+            int depth = 0;
+            while (true) {
+                pos_ = scan::FindFirstOf<'"', '[', ']', '{', '}'>(text_, pos_);
+                if (pos_ == text_.size()) {
+                    return false;
+                }
+                const char bracket = text_[pos_];
+                if (bracket == '"') {
+                    if (!SkipString()) {
+                        return false;
+                    }
+                    continue;
+                }
+                ++pos_;
+                depth += bracket == '[' || bracket == '{' ? 1 : -1;
+                if (depth == 0) {
+                    return true;
+                }
+            }
+        }
+        const size_t start = pos_;
+        pos_ = scan::FindFirstOf<',', ']', '}', ' ', '\n', '\r', '\t'>(text_, pos_);
+        return pos_ != start;
+    }
+
+private:
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+void WriteValue(Writer& writer, std::nullptr_t, int) {
+    writer.WriteNull();
 }
 
-template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
-    PrintString(value, ctx.out);
+void WriteValue(Writer& writer, bool value, int) {
+    writer.WriteBool(value);
 }
 
-template <>
-void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+void WriteValue(Writer& writer, int value, int) {
+    writer.WriteInt(value);
 }
 
-// В специализации шаблона PrintValue для типа bool параметр value передаётся
-// по константной ссылке, как и в основном шаблоне.
-// В качестве альтернативы можно использовать перегрузку:
-// void PrintValue(bool value, const PrintContext& ctx);
-template <>
-void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-    ctx.out << (value ? "true"sv : "false"sv);
+void WriteValue(Writer& writer, double value, int) {
+    writer.WriteDouble(value);
 }
 
-template <>
-void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "[\n"sv;
+void WriteValue(Writer& writer, const std::string& value, int) {
+    writer.WriteString(value);
+}
+
+// В красивом режиме пустой массив выводится как "[\n\n]", как и раньше
+void WriteValue(Writer& writer, const Array& nodes, int indent) {
+    const int inner_indent = indent + writer.GetOptions().indent_step;
+    writer.Put('[');
+    writer.BreakLine();
     bool first = true;
-    auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            writer.Put(',');
+            writer.BreakLine();
         }
-        inner_ctx.PrintIndent();
-        PrintNode(node, inner_ctx);
+        writer.PutIndent(inner_indent);
+        writer.WriteNode(node, inner_indent);
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put(']');
+    writer.BreakLine();
+    writer.PutIndent(indent);
+    writer.Put(']');
 }
 
-template <>
-void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "{\n"sv;
+void WriteValue(Writer& writer, const Dict& nodes, int indent) {
+    const int inner_indent = indent + writer.GetOptions().indent_step;
+    const std::string_view key_separator = writer.GetOptions().compact ? ":"sv : ": "sv;
+    writer.Put('{');
+    writer.BreakLine();
     bool first = true;
-    auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            writer.Put(',');
+            writer.BreakLine();
         }
-        inner_ctx.PrintIndent();
-        PrintString(key, ctx.out);
-        out << ": "sv;
-        PrintNode(node, inner_ctx);
+        writer.PutIndent(inner_indent);
+        writer.WriteString(key);
+        writer.Put(key_separator);
+        writer.WriteNode(node, inner_indent);
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put('}');
+    writer.BreakLine();
+    writer.PutIndent(indent);
+    writer.Put('}');
+}
+
+}  // namespace
+
+Document Load(std::istream& input) {
+    return Document{LoadNode(input)};
 }
 
-void PrintNode(const Node& node, const PrintContext& ctx) {
+Document Load(std::string_view input) {
+    NodeBuilder builder;
+    BufferParser<NodeBuilder>(input, builder).ParseValue();
+    return Document{builder.Extract()};
+}
+
+void Parse(std::string_view input, Handler& handler) {
+    BufferParser<Handler>(input, handler).ParseValue();
+}
+
+// Разделители повторяют BufferParser: запятые перед элементами и ключами необязательны
+std::optional<std::string_view> FindRootMember(std::string_view input, std::string_view key) {
+    StructureScanner scanner(input);
+    if (!scanner.Consume('{')) {
+        return std::nullopt;
+    }
+    while (!scanner.Consume('}')) {
+        while (scanner.Consume(',')) {
+        }
+        if (!scanner.AtQuote()) {
+            return std::nullopt;
+        }
+        const size_t key_start = scanner.GetPos() + 1;
+        if (!scanner.SkipString()) {
+            return std::nullopt;
+        }
+        const std::string_view member_key = input.substr(key_start, scanner.GetPos() - 1 - key_start);
+        if (!scanner.Consume(':')) {
+            return std::nullopt;
+        }
+        scanner.SkipSpaces();
+        const size_t value_start = scanner.GetPos();
+        if (!scanner.SkipValue()) {
+            return std::nullopt;
+        }
+        if (member_key == key) {
+            return input.substr(value_start, scanner.GetPos() - value_start);
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string_view> SplitArray(std::string_view array) {
+    StructureScanner scanner(array);
+    if (!scanner.Consume('[')) {
+        throw ParsingError("Array parsing error"s);
+    }
+    std::vector<std::string_view> elements;
+    while (!scanner.Consume(']')) {
+        scanner.Consume(',');
+        scanner.SkipSpaces();
+        const size_t start = scanner.GetPos();
+        if (!scanner.SkipValue()) {
+            throw ParsingError("Array parsing error"s);
+        }
+        elements.push_back(array.substr(start, scanner.GetPos() - start));
+    }
+    return elements;
+}
+
+void NodeBuilder::Null() {
+    AddValue(Node{nullptr});
+}
+
+void NodeBuilder::Bool(bool value) {
+    AddValue(Node{value});
+}
+
+void NodeBuilder::Int(int value) {
+    AddValue(Node{value});
+}
+
+void NodeBuilder::Double(double value) {
+    AddValue(Node{value});
+}
+
+void NodeBuilder::String(std::string_view value) {
+    AddValue(Node{std::string(value)});
+}
+
+void NodeBuilder::StartArray() {
+    stack_.emplace_back();
+}
+
+void NodeBuilder::EndArray() {
+    Node value{std::move(stack_.back().array)};
+    stack_.pop_back();
+    AddValue(std::move(value));
+}
+
+void NodeBuilder::StartDict() {
+    stack_.emplace_back();
+    stack_.back().is_dict = true;
+}
+
+void NodeBuilder::Key(std::string_view key) {
+    Frame& frame = stack_.back();
+    frame.key.assign(key);
+    if (frame.dict.find(frame.key) != frame.dict.end()) {
+        throw ParsingError("Duplicate key '"s + frame.key + "' have been found");
+    }
+}
+
+void NodeBuilder::EndDict() {
+    Node value{std::move(stack_.back().dict)};
+    stack_.pop_back();
+    AddValue(std::move(value));
+}
+
+bool NodeBuilder::IsComplete() const {
+    return has_root_ && stack_.empty();
+}
+
+Node NodeBuilder::Extract() {
+    has_root_ = false;
+    return std::move(root_);
+}
+
+void NodeBuilder::AddValue(Node value) {
+    if (stack_.empty()) {
+        root_ = std::move(value);
+        has_root_ = true;
+    } else if (Frame& frame = stack_.back(); frame.is_dict) {
+        frame.dict.emplace(std::move(frame.key), std::move(value));
+    } else {
+        frame.array.push_back(std::move(value));
+    }
+}
+
+Writer::Writer(std::ostream& output, PrintOptions options, size_t buffer_size)
+    : output_(output)
+    , options_(options)
+    , buffer_size_(std::max<size_t>(buffer_size, 64)) {
+    // Больше 17 значащих цифр не нужно ни одному double, чтобы прочитаться обратно без потерь
+    if (options_.precision) {
+        options_.precision = std::clamp(*options_.precision, 1, std::numeric_limits<double>::max_digits10);
+    }
+    buffer_.reserve(buffer_size_);
+}
+
+Writer::~Writer() {
+    Drain();
+}
+
+void Writer::WriteNode(const Node& node, int indent) {
     std::visit(
-        [&ctx](const auto& value) {
-            PrintValue(value, ctx);
+        [this, indent](const auto& value) {
+            WriteValue(*this, value, indent);
         },
         node.GetValue());
 }
 
+void Writer::WriteNull() {
+    Put("null"sv);
+}
+
+void Writer::WriteBool(bool value) {
+    Put(value ? "true"sv : "false"sv);
+}
+
+void Writer::WriteInt(int value) {
+    std::array<char, 16> chars;
+    const auto result = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+    Put(std::string_view(chars.data(), result.ptr - chars.data()));
+}
+
+void Writer::WriteDouble(double value) {
+    // Знак, 17 цифр, точка и порядок вида e-308 помещаются с запасом
+    std::array<char, 32> chars;
+    const auto result = options_.precision
+        ? std::to_chars(chars.data(), chars.data() + chars.size(), value, std::chars_format::general, *options_.precision)
+        : std::to_chars(chars.data(), chars.data() + chars.size(), value);
+    Put(std::string_view(chars.data(), result.ptr - chars.data()));
+}
+
+namespace {
+
+// Передаёт в put строку value в кавычках по кускам: участки без специальных символов целиком
+template <typename Put>
+void EscapeString(std::string_view value, Put&& put) {
+    put("\""sv);
+    const auto find_special = [value](size_t pos) {
+        return scan::FindFirstOf<'\r', '\n', '\t', '"', '\\'>(value, pos);
+    };
+    size_t plain_start = 0;
+    for (size_t i = find_special(0); i < value.size(); i = find_special(i + 1)) {
+        std::string_view escaped;
+        switch (value[i]) {
+            case '\r':
+                escaped = "\\r"sv;
+                break;
+            case '\n':
+                escaped = "\\n"sv;
+                break;
+            case '\t':
+                escaped = "\\t"sv;
+                break;
+            case '"':
+                escaped = "\\\""sv;
+                break;
+            case '\\':
+                escaped = "\\\\"sv;
+                break;
+        }
+        put(value.substr(plain_start, i - plain_start));
+        put(escaped);
+        plain_start = i + 1;
+    }
+    put(value.substr(plain_start));
+    put("\""sv);
+}
+
 }  // namespace
 
-Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+void AppendString(std::string& out, std::string_view value) {
+    EscapeString(value, [&out](std::string_view part) {
+        out.append(part);
+    });
+}
+
+void Writer::WriteString(std::string_view value) {
+    EscapeString(value, [this](std::string_view part) {
+        Put(part);
+    });
+}
+
+void Writer::WriteRaw(std::string_view json) {
+    Put(json);
+}
+
+void Writer::Put(char c) {
+    buffer_.push_back(c);
+    if (buffer_.size() >= buffer_size_) {
+        Drain();
+    }
+}
+
+void Writer::Put(std::string_view str) {
+    if (buffer_.size() + str.size() > buffer_size_) {
+        Drain();
+        // Длинные строки, например SVG-карта, передаются в поток без копирования в буфер
+        if (str.size() >= buffer_size_) {
+            output_.write(str.data(), static_cast<std::streamsize>(str.size()));
+            return;
+        }
+    }
+    buffer_.append(str);
+}
+
+void Writer::BreakLine() {
+    if (!options_.compact) {
+        Put('\n');
+    }
+}
+
+void Writer::PutIndent(int indent) {
+    if (!options_.compact) {
+        buffer_.append(static_cast<size_t>(indent), ' ');
+        if (buffer_.size() >= buffer_size_) {
+            Drain();
+        }
+    }
+}
+
+void Writer::Flush() {
+    Drain();
+    output_.flush();
+}
+
+const PrintOptions& Writer::GetOptions() const {
+    return options_;
+}
+
+void Writer::Drain() {
+    if (!buffer_.empty()) {
+        output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
 }
 
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+    Print(doc, output, PrintOptions{});
+}
+
+void Print(const Document& doc, std::ostream& output, const PrintOptions& options) {
+    Writer writer(output, options);
+    writer.WriteNode(doc.GetRoot());
+}
+
+ArrayWriter::ArrayWriter(std::ostream& output, size_t flush_interval, PrintOptions options)
+    : writer_(output, options)
+    , flush_interval_(std::max<size_t>(flush_interval, 1)) {
+    writer_.Put('[');
+    writer_.BreakLine();
+}
+
+void ArrayWriter::Write(const Node& node) {
+    const int indent = BeginElement();
+    writer_.WriteNode(node, indent);
+    EndElement();
+}
+
+int ArrayWriter::BeginElement() {
+    if (finished_) {
+        throw std::logic_error("Write called after Finish"s);
+    }
+    if (written_ > 0) {
+        writer_.Put(',');
+        writer_.BreakLine();
+    }
+    // Элементы массива печатаются с тем же отступом, что и внутри Print
+    const int indent = writer_.GetOptions().indent_step;
+    writer_.PutIndent(indent);
+    return indent;
+}
+
+void ArrayWriter::EndElement() {
+    if (++written_ % flush_interval_ == 0) {
+        writer_.Flush();
+    }
+}
+
+Writer& ArrayWriter::GetWriter() {
+    return writer_;
+}
+
+void ArrayWriter::Finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    writer_.BreakLine();
+    writer_.Put(']');
+    writer_.Flush();
 }
 
 }  // namespace json
\ No newline at end of file
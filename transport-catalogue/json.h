@@ -2,7 +2,9 @@
 
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -135,8 +137,163 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+/*
+ * Обработчик событий потокового (SAX) разбора JSON.
+ * Строки, переданные в String и Key, действительны только во время вызова
+ */
+class Handler {
+public:
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+
+protected:
+    ~Handler() = default;
+};
+
+// Собирает дерево Node из событий разбора
+class NodeBuilder final : public Handler {
+public:
+    void Null() override;
+    void Bool(bool value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+    void StartArray() override;
+    void EndArray() override;
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    // Разобрано ли полностью корневое значение
+    bool IsComplete() const;
+    Node Extract();
+
+private:
+    struct Frame {
+        bool is_dict = false;
+        Array array;
+        Dict dict;
+        std::string key;
+    };
+
+    void AddValue(Node value);
+
+    std::vector<Frame> stack_;
+    Node root_;
+    bool has_root_ = false;
+};
+
 Document Load(std::istream& input);
 
+// Разбирает JSON из непрерывного буфера, например файла, прочитанного целиком или отображённого в память
+Document Load(std::string_view input);
+
+// Разбирает JSON из буфера, передавая события обработчику без построения дерева
+void Parse(std::string_view input, Handler& handler);
+
+// Структурный просмотр без разбора значений: учитываются только строки и скобки.
+// Возвращает текст значения по ключу key корневого словаря; nullopt, если ключа нет или структура нарушена
+std::optional<std::string_view> FindRootMember(std::string_view input, std::string_view key);
+
+// Делит текст массива на тексты элементов, не разбирая сами элементы
+std::vector<std::string_view> SplitArray(std::string_view array);
+
+// Параметры вывода JSON
+struct PrintOptions {
+    // Без пробелов и переводов строк между элементами
+    bool compact = false;
+    int indent_step = 4;
+    // Число значащих цифр для double, как у std::ostream по умолчанию.
+    // std::nullopt - кратчайшая запись, которая читается обратно в то же самое число
+    std::optional<int> precision = 6;
+};
+
+// Дописывает в out строку value в кавычках и с экранированием - так же, как её выводит Writer
+void AppendString(std::string& out, std::string_view value);
+
+/*
+ * Буферизованный вывод JSON. Текст копится в собственном буфере и передаётся
+ * в поток крупными блоками, когда буфер заполнен, а также в Flush и деструкторе.
+ * Числа форматируются через std::to_chars, без участия локали потока
+ */
+class Writer {
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    explicit Writer(std::ostream& output, PrintOptions options = {}, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer();
+
+    // indent - текущий отступ, с которого начинается значение
+    void WriteNode(const Node& node, int indent = 0);
+
+    void WriteNull();
+    void WriteBool(bool value);
+    void WriteInt(int value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+    // Готовый текст JSON-значения, например строка из AppendString; выводится как есть
+    void WriteRaw(std::string_view json);
+
+    // Служебные символы разметки; в компактном режиме BreakLine и PutIndent ничего не выводят
+    void Put(char c);
+    void Put(std::string_view str);
+    void BreakLine();
+    void PutIndent(int indent);
+
+    // Передаёт накопленный текст в поток и сбрасывает поток
+    void Flush();
+
+    const PrintOptions& GetOptions() const;
+
+private:
+    void Drain();
+
+    std::ostream& output_;
+    PrintOptions options_;
+    size_t buffer_size_;
+    std::string buffer_;
+};
+
 void Print(const Document& doc, std::ostream& output);
+void Print(const Document& doc, std::ostream& output, const PrintOptions& options);
+
+/*
+ * Выводит корневой массив поэлементно, по мере готовности элементов.
+ * Результат совпадает с Print для массива из тех же элементов.
+ * Поток сбрасывается каждые flush_interval элементов, поэтому ответы
+ * покидают процесс, не дожидаясь конца всего массива
+ */
+class ArrayWriter {
+public:
+    explicit ArrayWriter(std::ostream& output, size_t flush_interval = 64, PrintOptions options = {});
+    ArrayWriter(const ArrayWriter&) = delete;
+    ArrayWriter& operator=(const ArrayWriter&) = delete;
+
+    void Write(const Node& node);
+    // Закрывает массив; после вызова Write недопустим
+    void Finish();
+
+    // Для записи элемента без построения Node: BeginElement выводит разделитель
+    // и возвращает отступ элемента, EndElement отмечает элемент записанным
+    int BeginElement();
+    void EndElement();
+    Writer& GetWriter();
+
+private:
+    Writer writer_;
+    size_t flush_interval_;
+    size_t written_ = 0;
+    bool finished_ = false;
+};
 
 }  // namespace json
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "json_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+namespace json {
+
+using namespace std::literals;
+
+ArenaDict::ArenaDict(const ArenaMember* members, size_t size)
+    : members_(members)
+    , size_(size) {
+}
+
+ArenaDict::const_iterator ArenaDict::begin() const {
+    return members_;
+}
+
+ArenaDict::const_iterator ArenaDict::end() const {
+    return members_ + size_;
+}
+
+size_t ArenaDict::size() const {
+    return size_;
+}
+
+bool ArenaDict::empty() const {
+    return size_ == 0;
+}
+
+ArenaDict::const_iterator ArenaDict::find(std::string_view key) const {
+    const auto it = std::lower_bound(begin(), end(), key, [](const ArenaMember& member, std::string_view key) {
+        return member.first < key;
+    });
+    return it != end() && it->first == key ? it : end();
+}
+
+size_t ArenaDict::count(std::string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+const ArenaNode& ArenaDict::at(std::string_view key) const {
+    const auto it = find(key);
+    if (it == end()) {
+        throw std::out_of_range("No key '"s + std::string(key) + "' in dict"s);
+    }
+    return it->second;
+}
+
+ArenaNode::ArenaNode(std::nullptr_t) {
+}
+
+ArenaNode::ArenaNode(bool value)
+    : type_(Type::BOOL)
+    , bool_(value) {
+}
+
+ArenaNode::ArenaNode(int value)
+    : type_(Type::INT)
+    , int_(value) {
+}
+
+ArenaNode::ArenaNode(double value)
+    : type_(Type::DOUBLE)
+    , double_(value) {
+}
+
+ArenaNode::ArenaNode(std::string_view value)
+    : type_(Type::STRING)
+    , size_(static_cast<uint32_t>(value.size()))
+    , data_(value.data()) {
+}
+
+ArenaNode::ArenaNode(const char* value)
+    : ArenaNode(std::string_view(value)) {
+}
+
+ArenaNode::ArenaNode(ArenaArray value)
+    : type_(Type::ARRAY)
+    , size_(static_cast<uint32_t>(value.size()))
+    , data_(value.data()) {
+}
+
+ArenaNode::ArenaNode(ArenaDict value)
+    : type_(Type::DICT)
+    , size_(static_cast<uint32_t>(value.size()))
+    , data_(value.begin()) {
+}
+
+bool ArenaNode::IsInt() const {
+    return type_ == Type::INT;
+}
+
+int ArenaNode::AsInt() const {
+    if (!IsInt()) {
+        throw std::logic_error("Not an int"s);
+    }
+    return int_;
+}
+
+bool ArenaNode::IsPureDouble() const {
+    return type_ == Type::DOUBLE;
+}
+
+bool ArenaNode::IsDouble() const {
+    return IsInt() || IsPureDouble();
+}
+
+double ArenaNode::AsDouble() const {
+    if (!IsDouble()) {
+        throw std::logic_error("Not a double"s);
+    }
+    return IsPureDouble() ? double_ : int_;
+}
+
+bool ArenaNode::IsBool() const {
+    return type_ == Type::BOOL;
+}
+
+bool ArenaNode::AsBool() const {
+    if (!IsBool()) {
+        throw std::logic_error("Not a bool"s);
+    }
+    return bool_;
+}
+
+bool ArenaNode::IsNull() const {
+    return type_ == Type::NUL;
+}
+
+bool ArenaNode::IsArray() const {
+    return type_ == Type::ARRAY;
+}
+
+ArenaArray ArenaNode::AsArray() const {
+    if (!IsArray()) {
+        throw std::logic_error("Not an array"s);
+    }
+    return {static_cast<const ArenaNode*>(data_), size_};
+}
+
+bool ArenaNode::IsString() const {
+    return type_ == Type::STRING;
+}
+
+std::string_view ArenaNode::AsString() const {
+    if (!IsString()) {
+        throw std::logic_error("Not a string"s);
+    }
+    return {static_cast<const char*>(data_), size_};
+}
+
+bool ArenaNode::IsDict() const {
+    return type_ == Type::DICT;
+}
+
+ArenaDict ArenaNode::AsDict() const {
+    if (!IsDict()) {
+        throw std::logic_error("Not a dict"s);
+    }
+    return {static_cast<const ArenaMember*>(data_), size_};
+}
+
+ArenaDocument::ArenaDocument()
+    : storage_(std::make_unique<Storage>()) {
+}
+
+const ArenaNode& ArenaDocument::GetRoot() const {
+    return root_;
+}
+
+size_t ArenaDocument::GetArenaBytes() const {
+    return storage_->bytes;
+}
+
+ArenaBuilder::ArenaBuilder(std::string input) {
+    document_.storage_->input = std::move(input);
+}
+
+std::string_view ArenaBuilder::GetInput() const {
+    return document_.storage_->input;
+}
+
+void ArenaBuilder::Null() {
+    AddValue(ArenaNode{nullptr});
+}
+
+void ArenaBuilder::Bool(bool value) {
+    AddValue(ArenaNode{value});
+}
+
+void ArenaBuilder::Int(int value) {
+    AddValue(ArenaNode{value});
+}
+
+void ArenaBuilder::Double(double value) {
+    AddValue(ArenaNode{value});
+}
+
+void ArenaBuilder::String(std::string_view value) {
+    AddValue(ArenaNode{Store(value)});
+}
+
+void ArenaBuilder::StartArray() {
+    frames_.push_back({values_.size(), key_, false});
+}
+
+void ArenaBuilder::EndArray() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    const size_t size = values_.size() - frame.start;
+    ArenaNode* items = Allocate<ArenaNode>(size);
+    for (size_t i = 0; i < size; ++i) {
+        new (items + i) ArenaNode(values_[frame.start + i].second);
+    }
+    values_.resize(frame.start);
+    key_ = frame.key;
+    AddValue(ArenaNode{ArenaArray{items, size}});
+}
+
+void ArenaBuilder::StartDict() {
+    frames_.push_back({values_.size(), key_, true});
+}
+
+void ArenaBuilder::Key(std::string_view key) {
+    key_ = Store(key);
+}
+
+// Ключи сортируются один раз при закрытии словаря; повторы оказываются рядом
+// и сразу дают ошибку, поэтому устойчивая сортировка не нужна
+void ArenaBuilder::EndDict() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    const auto first = values_.begin() + static_cast<std::ptrdiff_t>(frame.start);
+    std::sort(first, values_.end(), [](const ArenaMember& lhs, const ArenaMember& rhs) {
+        return lhs.first < rhs.first;
+    });
+    if (const auto duplicate = std::adjacent_find(first, values_.end(), [](const ArenaMember& lhs, const ArenaMember& rhs) {
+            return lhs.first == rhs.first;
+        });
+        duplicate != values_.end()) {
+        throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+    }
+    const size_t size = values_.size() - frame.start;
+    ArenaMember* members = Allocate<ArenaMember>(size);
+    std::uninitialized_copy(first, values_.end(), members);
+    values_.resize(frame.start);
+    key_ = frame.key;
+    AddValue(ArenaNode{ArenaDict{members, size}});
+}
+
+bool ArenaBuilder::IsComplete() const {
+    return has_root_ && frames_.empty();
+}
+
+ArenaDocument ArenaBuilder::Extract() {
+    has_root_ = false;
+    return std::move(document_);
+}
+
+void ArenaBuilder::AddValue(ArenaNode value) {
+    if (frames_.empty()) {
+        document_.root_ = value;
+        has_root_ = true;
+    } else {
+        values_.emplace_back(frames_.back().is_dict ? key_ : std::string_view{}, value);
+    }
+}
+
+std::string_view ArenaBuilder::Store(std::string_view str) {
+    const std::string_view input = GetInput();
+    if (str.empty()) {
+        return {};
+    }
+    if (str.data() >= input.data() && str.data() + str.size() <= input.data() + input.size()) {
+        return str;
+    }
+    char* data = Allocate<char>(str.size());
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+template <typename T>
+T* ArenaBuilder::Allocate(size_t count) {
+    if (count == 0) {
+        return nullptr;
+    }
+    document_.storage_->bytes += count * sizeof(T);
+    // Объекты создаются в этой памяти вызывающим кодом
+    return static_cast<T*>(document_.storage_->arena.allocate(count * sizeof(T), alignof(T)));
+}
+
+ArenaDocument LoadArena(std::string input) {
+    ArenaBuilder builder(std::move(input));
+    Parse(builder.GetInput(), builder);
+    return builder.Extract();
+}
+
+} // namespace json
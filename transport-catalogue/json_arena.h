@@ -0,0 +1,178 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+    class ArenaNode;
+    using ArenaMember = std::pair<std::string_view, ArenaNode>;
+
+    /*
+     * Словарь документа в арене: отсортированный по ключам непрерывный массив пар.
+     * Интерфейс повторяет используемую часть std::map, поиск двоичный
+     */
+    class ArenaDict {
+    public:
+        using value_type = ArenaMember;
+        using const_iterator = const ArenaMember*;
+        using iterator = const_iterator;
+
+        ArenaDict() = default;
+        ArenaDict(const ArenaMember* members, size_t size);
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        size_t size() const;
+        bool empty() const;
+
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+        // Бросает std::out_of_range, если ключа нет
+        const ArenaNode& at(std::string_view key) const;
+
+    private:
+        const ArenaMember* members_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    using ArenaArray = std::span<const ArenaNode>;
+
+    /*
+     * Узел документа, размещённого в арене. Не владеет данными: строки указывают
+     * во входной буфер или в арену документа, массивы и словари - в арену.
+     * Интерфейс совпадает с Node, но AsString возвращает string_view
+     */
+    class ArenaNode {
+    public:
+        ArenaNode() = default;
+        ArenaNode(std::nullptr_t);
+        ArenaNode(bool value);
+        ArenaNode(int value);
+        ArenaNode(double value);
+        ArenaNode(std::string_view value);
+        // Без этой перегрузки строковый литерал превратился бы в bool
+        ArenaNode(const char* value);
+        ArenaNode(ArenaArray value);
+        ArenaNode(ArenaDict value);
+
+        bool IsInt() const;
+        int AsInt() const;
+        bool IsPureDouble() const;
+        bool IsDouble() const;
+        double AsDouble() const;
+        bool IsBool() const;
+        bool AsBool() const;
+        bool IsNull() const;
+        bool IsArray() const;
+        ArenaArray AsArray() const;
+        bool IsString() const;
+        std::string_view AsString() const;
+        bool IsDict() const;
+        ArenaDict AsDict() const;
+
+    private:
+        enum class Type : uint8_t {
+            NUL,
+            BOOL,
+            INT,
+            DOUBLE,
+            STRING,
+            ARRAY,
+            DICT
+        };
+
+        Type type_ = Type::NUL;
+        uint32_t size_ = 0;
+        union {
+            bool bool_;
+            int int_;
+            double double_ = 0.0;
+            const void* data_;
+        };
+    };
+
+    /*
+     * Документ, все узлы которого лежат в одной арене и освобождаются разом.
+     * Документ можно перемещать: узлы и строки при этом не копируются
+     */
+    class ArenaDocument {
+    public:
+        ArenaDocument();
+
+        const ArenaNode& GetRoot() const;
+        // Память, выделенная под узлы и скопированные строки
+        size_t GetArenaBytes() const;
+
+    private:
+        friend class ArenaBuilder;
+
+        // Отдельный объект, чтобы адреса входа и арены не менялись при перемещении документа
+        struct Storage {
+            std::string input;
+            std::pmr::monotonic_buffer_resource arena;
+            size_t bytes = 0;
+        };
+
+        std::unique_ptr<Storage> storage_;
+        ArenaNode root_;
+    };
+
+    /*
+     * Собирает ArenaDocument из событий разбора.
+     * Строки, лежащие внутри переданного входа, не копируются, поэтому
+     * разбирать нужно буфер GetInput(); вход переходит во владение документа.
+     * Остальные строки (с escape-последовательностями или из чужого буфера)
+     * копируются в арену
+     */
+    class ArenaBuilder final : public Handler {
+    public:
+        explicit ArenaBuilder(std::string input = {});
+
+        std::string_view GetInput() const;
+
+        void Null() override;
+        void Bool(bool value) override;
+        void Int(int value) override;
+        void Double(double value) override;
+        void String(std::string_view value) override;
+        void StartArray() override;
+        void EndArray() override;
+        void StartDict() override;
+        void Key(std::string_view key) override;
+        void EndDict() override;
+
+        bool IsComplete() const;
+        ArenaDocument Extract();
+
+    private:
+        struct Frame {
+            size_t start;
+            std::string_view key;
+            bool is_dict;
+        };
+
+        void AddValue(ArenaNode value);
+        std::string_view Store(std::string_view str);
+        template <typename T>
+        T* Allocate(size_t count);
+
+        ArenaDocument document_;
+        // Готовые элементы незакрытых контейнеров; у элементов массива ключ пустой
+        std::vector<ArenaMember> values_;
+        std::vector<Frame> frames_;
+        std::string_view key_;
+        bool has_root_ = false;
+    };
+
+    ArenaDocument LoadArena(std::string input);
+
+} // namespace json
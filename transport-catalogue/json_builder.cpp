@@ -33,8 +33,8 @@ DictItemContext Builder::StartDict() {
         const_cast<Array&>(current->AsArray()).emplace_back(Dict{});
         nodes_stack_.push_back(&const_cast<Array&>(current->AsArray()).back());
     } else if (has_key_) {
-        const_cast<Dict&>(current->AsDict()).emplace(last_key_, Dict{});
-        nodes_stack_.push_back(&const_cast<Dict&>(current->AsDict()).at(last_key_));
+        auto [it, inserted] = const_cast<Dict&>(current->AsDict()).emplace(std::move(last_key_), Dict{});
+        nodes_stack_.push_back(&it->second);
         has_key_ = false;
     } else {
         throw std::logic_error("StartDict called without Key in Dict");
@@ -55,8 +55,8 @@ DictItemContext Builder::StartDict() {
         const_cast<Array&>(current->AsArray()).emplace_back(Array{});
         nodes_stack_.push_back(&const_cast<Array&>(current->AsArray()).back());
     } else if (has_key_) {
-        const_cast<Dict&>(current->AsDict()).emplace(last_key_, Array{});
-        nodes_stack_.push_back(&const_cast<Dict&>(current->AsDict()).at(last_key_));
+        auto [it, inserted] = const_cast<Dict&>(current->AsDict()).emplace(std::move(last_key_), Array{});
+        nodes_stack_.push_back(&it->second);
         has_key_ = false;
     } else {
         throw std::logic_error("StartArray called without Key in Dict");
@@ -140,49 +140,180 @@ Node* Builder::GetCurrentNode() {
     return nodes_stack_.empty() ? nullptr : nodes_stack_.back();
 }
 
-    DictItemContext::DictItemContext(Builder& builder) : builder_(builder) {}
+StreamBuilder::StreamBuilder(Writer& writer, int indent)
+    : writer_(writer)
+    , indent_(indent) {
+}
+
+StreamBuilder::StreamBuilder(ArrayWriter& array)
+    : writer_(array.GetWriter())
+    , array_(&array)
+    , indent_(0) {
+}
+
+StreamDictItemContext StreamBuilder::StartDict() {
+    StartContainer(true, '{');
+    return StreamDictItemContext(*this);
+}
+
+StreamArrayItemContext StreamBuilder::StartArray() {
+    StartContainer(false, '[');
+    return StreamArrayItemContext(*this);
+}
+
+void StreamBuilder::Build() {
+    if (!has_root_) {
+        throw std::logic_error("Build called on empty Builder");
+    }
+    if (depth_ != 0) {
+        throw std::logic_error("Build called with unfinished container");
+    }
+    if (array_ != nullptr) {
+        array_->EndElement();
+        array_ = nullptr;
+    }
+}
 
-    KeyItemContext DictItemContext::Key(std::string key) const {
-    builder_.Key(std::move(key));
-    return KeyItemContext(builder_);
+StreamBuilder& StreamBuilder::Value(std::nullptr_t) {
+    BeginValue();
+    writer_.WriteNull();
+    return *this;
 }
 
-    Builder& DictItemContext::EndDict() const {
-    return builder_.EndDict();
+StreamBuilder& StreamBuilder::Value(bool value) {
+    BeginValue();
+    writer_.WriteBool(value);
+    return *this;
 }
 
-    KeyItemContext::KeyItemContext(Builder& builder) : builder_(builder) {}
+StreamBuilder& StreamBuilder::Value(int value) {
+    BeginValue();
+    writer_.WriteInt(value);
+    return *this;
+}
 
-    DictItemContext KeyItemContext::Value(Node value) const {
-    builder_.Value(std::move(value));
-    return DictItemContext(builder_);
+StreamBuilder& StreamBuilder::Value(double value) {
+    BeginValue();
+    writer_.WriteDouble(value);
+    return *this;
 }
 
-    DictItemContext KeyItemContext::StartDict() const {
-    return builder_.StartDict();
+StreamBuilder& StreamBuilder::Value(std::string_view value) {
+    BeginValue();
+    writer_.WriteString(value);
+    return *this;
 }
 
-    ArrayItemContext KeyItemContext::StartArray() const {
-    return builder_.StartArray();
+StreamBuilder& StreamBuilder::Value(const std::string& value) {
+    return Value(std::string_view(value));
 }
 
-    ArrayItemContext::ArrayItemContext(Builder& builder) : builder_(builder) {}
+StreamBuilder& StreamBuilder::Value(const char* value) {
+    return Value(std::string_view(value));
+}
 
-    ArrayItemContext& ArrayItemContext::Value(Node value) {
-    builder_.Value(std::move(value));
+StreamBuilder& StreamBuilder::Value(const Node& value) {
+    writer_.WriteNode(value, BeginValue());
     return *this;
 }
 
-    DictItemContext ArrayItemContext::StartDict() const {
-    return builder_.StartDict();
+StreamBuilder& StreamBuilder::RawValue(std::string_view json) {
+    BeginValue();
+    writer_.WriteRaw(json);
+    return *this;
 }
 
-    ArrayItemContext ArrayItemContext::StartArray() const {
-    return builder_.StartArray();
+StreamBuilder& StreamBuilder::Key(std::string_view key) {
+    if (depth_ == 0 || !frames_[depth_ - 1].is_dict) {
+        throw std::logic_error("Key called outside of Dict");
+    }
+    Frame& frame = frames_[depth_ - 1];
+    if (frame.has_key) {
+        throw std::logic_error("Key called twice in a row");
+    }
+#ifndef NDEBUG
+    // Порядок Dict: ключи по возрастанию и без повторов
+    if (!frame.empty && key <= std::string_view(frame.last_key)) {
+        throw std::logic_error("Key '" + std::string(key) + "' does not follow '" + frame.last_key + "' in ascending order");
+    }
+    frame.last_key.assign(key);
+#endif
+    if (!frame.empty) {
+        writer_.Put(',');
+        writer_.BreakLine();
+    }
+    writer_.PutIndent(GetIndent(depth_));
+    writer_.WriteString(key);
+    writer_.Put(writer_.GetOptions().compact ? ":" : ": ");
+    frame.has_key = true;
+    frame.empty = false;
+    return *this;
+}
+
+StreamBuilder& StreamBuilder::EndDict() {
+    EndContainer(true, '}');
+    return *this;
+}
+
+StreamBuilder& StreamBuilder::EndArray() {
+    EndContainer(false, ']');
+    return *this;
+}
+
+int StreamBuilder::BeginValue() {
+    if (depth_ == 0) {
+        if (has_root_) {
+            throw std::logic_error("Method called after Build");
+        }
+        has_root_ = true;
+        if (array_ != nullptr) {
+            indent_ = array_->BeginElement();
+        }
+        return indent_;
+    }
+    Frame& frame = frames_[depth_ - 1];
+    if (frame.is_dict) {
+        if (!frame.has_key) {
+            throw std::logic_error("Value called in Dict without Key");
+        }
+        frame.has_key = false;
+    } else {
+        if (!frame.empty) {
+            writer_.Put(',');
+            writer_.BreakLine();
+        }
+        writer_.PutIndent(GetIndent(depth_));
+        frame.empty = false;
+    }
+    return GetIndent(depth_);
+}
+
+// Разметка повторяет вывод Array и Dict в json.cpp
+void StreamBuilder::StartContainer(bool is_dict, char bracket) {
+    if (depth_ == MAX_DEPTH) {
+        throw std::logic_error("Too deep nesting");
+    }
+    BeginValue();
+    writer_.Put(bracket);
+    writer_.BreakLine();
+    frames_[depth_++] = Frame{is_dict};
+}
+
+void StreamBuilder::EndContainer(bool is_dict, char bracket) {
+    if (depth_ == 0 || frames_[depth_ - 1].is_dict != is_dict) {
+        throw std::logic_error(is_dict ? "EndDict called without StartDict" : "EndArray called without StartArray");
+    }
+    if (frames_[depth_ - 1].has_key) {
+        throw std::logic_error("EndDict called after Key");
+    }
+    --depth_;
+    writer_.BreakLine();
+    writer_.PutIndent(GetIndent(depth_));
+    writer_.Put(bracket);
 }
 
-    Builder& ArrayItemContext::EndArray() const {
-    return builder_.EndArray();
+int StreamBuilder::GetIndent(size_t depth) const {
+    return indent_ + static_cast<int>(depth) * writer_.GetOptions().indent_step;
 }
 
-} // namespace json
\ No newline at end of file
+} // namespace json
@@ -1,17 +1,32 @@
 #pragma once
 
 #include "json.h"
+#include <array>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace json {
 
+    template <typename Builder>
+    class BasicDictItemContext;
+    template <typename Builder>
+    class BasicKeyItemContext;
+    template <typename Builder>
+    class BasicArrayItemContext;
+
+    class Builder;
+    using DictItemContext = BasicDictItemContext<Builder>;
+    using KeyItemContext = BasicKeyItemContext<Builder>;
+    using ArrayItemContext = BasicArrayItemContext<Builder>;
+
     class Builder {
     public:
         Builder() = default;
 
-        class DictItemContext StartDict();
-        class ArrayItemContext StartArray();
+        DictItemContext StartDict();
+        ArrayItemContext StartArray();
 
         Node Build();
 
@@ -34,39 +49,146 @@ namespace json {
         Node* GetCurrentNode();
     };
 
-    class KeyItemContext;
+    class StreamBuilder;
+    using StreamDictItemContext = BasicDictItemContext<StreamBuilder>;
+    using StreamKeyItemContext = BasicKeyItemContext<StreamBuilder>;
+    using StreamArrayItemContext = BasicArrayItemContext<StreamBuilder>;
+
+    /*
+     * Builder, который не строит Node, а сразу выводит значение через Writer.
+     * Ключи словаря выводятся в порядке вызовов Key, поэтому для совпадения
+     * с выводом Dict их нужно передавать по алфавиту; в отладочной сборке (без NDEBUG)
+     * Key бросает std::logic_error на ключ, не больший предыдущего в том же словаре.
+     * Стек открытых контейнеров фиксированной глубины, куча не используется
+     */
+    class StreamBuilder {
+    public:
+        static constexpr size_t MAX_DEPTH = 32;
+
+        explicit StreamBuilder(Writer& writer, int indent = 0);
+        // Значение станет очередным элементом массива; элемент открывается при первой записи
+        explicit StreamBuilder(ArrayWriter& array);
+        StreamBuilder(const StreamBuilder&) = delete;
+        StreamBuilder& operator=(const StreamBuilder&) = delete;
+
+        StreamDictItemContext StartDict();
+        StreamArrayItemContext StartArray();
+
+        // Проверяет, что значение записано полностью
+        void Build();
+
+        StreamBuilder& Value(std::nullptr_t);
+        StreamBuilder& Value(bool value);
+        StreamBuilder& Value(int value);
+        StreamBuilder& Value(double value);
+        StreamBuilder& Value(std::string_view value);
+        StreamBuilder& Value(const std::string& value);
+        StreamBuilder& Value(const char* value);
+        StreamBuilder& Value(const Node& value);
+        // Значение, уже записанное в JSON, например строка из json::AppendString
+        StreamBuilder& RawValue(std::string_view json);
+        StreamBuilder& Key(std::string_view key);
+        StreamBuilder& EndDict();
+        StreamBuilder& EndArray();
+
+    private:
+        struct Frame {
+            bool is_dict = false;
+            bool has_key = false;
+            bool empty = true;
+#ifndef NDEBUG
+            // Предыдущий ключ словаря для проверки порядка
+            std::string last_key;
+#endif
+        };
+
+        // Выводит разделитель и отступ перед значением, возвращает отступ значения
+        int BeginValue();
+        void StartContainer(bool is_dict, char bracket);
+        void EndContainer(bool is_dict, char bracket);
+        int GetIndent(size_t depth) const;
+
+        Writer& writer_;
+        ArrayWriter* array_ = nullptr;
+        int indent_;
+        std::array<Frame, MAX_DEPTH> frames_;
+        size_t depth_ = 0;
+        bool has_root_ = false;
+    };
 
-    class DictItemContext {
+    template <typename Builder>
+    class BasicDictItemContext {
     public:
-        explicit DictItemContext(Builder& builder);
-        KeyItemContext Key(std::string key) const;
-        Builder& EndDict() const;
+        explicit BasicDictItemContext(Builder& builder)
+            : builder_(builder) {
+        }
+
+        template <typename KeyType>
+        BasicKeyItemContext<Builder> Key(KeyType&& key) const {
+            builder_.Key(std::forward<KeyType>(key));
+            return BasicKeyItemContext<Builder>(builder_);
+        }
+
+        Builder& EndDict() const {
+            return builder_.EndDict();
+        }
 
     private:
         Builder& builder_;
     };
 
-    class KeyItemContext {
+    template <typename Builder>
+    class BasicKeyItemContext {
     public:
-        explicit KeyItemContext(Builder& builder);
-        DictItemContext Value(Node value) const;
-        DictItemContext StartDict() const;
-        ArrayItemContext StartArray() const;
+        explicit BasicKeyItemContext(Builder& builder)
+            : builder_(builder) {
+        }
+
+        template <typename ValueType>
+        BasicDictItemContext<Builder> Value(ValueType&& value) const {
+            builder_.Value(std::forward<ValueType>(value));
+            return BasicDictItemContext<Builder>(builder_);
+        }
+
+        BasicDictItemContext<Builder> StartDict() const {
+            return builder_.StartDict();
+        }
+
+        BasicArrayItemContext<Builder> StartArray() const {
+            return builder_.StartArray();
+        }
 
     private:
         Builder& builder_;
     };
 
-    class ArrayItemContext {
+    template <typename Builder>
+    class BasicArrayItemContext {
     public:
-        explicit ArrayItemContext(Builder& builder);
-        ArrayItemContext& Value(Node value);
-        DictItemContext StartDict() const;
-        ArrayItemContext StartArray() const;
-        Builder& EndArray() const;
+        explicit BasicArrayItemContext(Builder& builder)
+            : builder_(builder) {
+        }
+
+        template <typename ValueType>
+        BasicArrayItemContext& Value(ValueType&& value) {
+            builder_.Value(std::forward<ValueType>(value));
+            return *this;
+        }
+
+        BasicDictItemContext<Builder> StartDict() const {
+            return builder_.StartDict();
+        }
+
+        BasicArrayItemContext<Builder> StartArray() const {
+            return builder_.StartArray();
+        }
+
+        Builder& EndArray() const {
+            return builder_.EndArray();
+        }
 
     private:
         Builder& builder_;
     };
 
-} // namespace json
\ No newline at end of file
+} // namespace json
@@ -3,20 +3,1102 @@
 #include "graph.h"
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 #include <iterator>
 #include <iostream>
+#include <limits>
 
 #include "router.h"
 
 namespace transport {
 
-JsonReader::JsonReader()
-    : document_(json::Node()) {
+namespace {
+
+// Node хранит только int, поэтому большие объёмы выводятся как double
+json::Node SizeToNode(size_t value) {
+    if (value <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return static_cast<int>(value);
+    }
+    return static_cast<double>(value);
+}
+
+// Записывает Usage словарём {"bytes", "elements"} под ключом key
+void WriteUsage(json::StreamBuilder& builder, std::string_view key, const memory::Usage& usage) {
+    builder.Key(key).StartDict()
+        .Key("bytes").Value(SizeToNode(usage.bytes))
+        .Key("elements").Value(SizeToNode(usage.elements))
+        .EndDict();
+}
+
+std::string ReadAll(std::istream& in) {
+    std::string buffer;
+    char chunk[1 << 16];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+        buffer.append(chunk, static_cast<size_t>(in.gcount()));
+    }
+    return buffer;
+}
+
+// Элемент base_requests. Строки указывают во входной буфер или в арену декодера
+struct BaseRequest {
+    explicit BaseRequest(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : road_distances(resource)
+        , stops(resource) {
+    }
+
+    // Готовит запрос к повторному заполнению; память векторов переиспользуется
+    void Clear() {
+        type = {};
+        name = {};
+        latitude = 0.0;
+        longitude = 0.0;
+        is_roundtrip = false;
+        road_distances.clear();
+        stops.clear();
+    }
+
+    std::string_view type;
+    std::string_view name;
+    double latitude = 0.0;
+    double longitude = 0.0;
+    bool is_roundtrip = false;
+    std::pmr::vector<std::pair<std::string_view, int>> road_distances;
+    std::pmr::vector<std::string_view> stops;
+};
+
+// Заполняет request из элемента base_requests уже разобранного документа
+void DecodeBaseRequest(const json::ArenaDict& item_map, BaseRequest& request) {
+    request.Clear();
+    request.type = item_map.at("type").AsString();
+    if (request.type == "Stop") {
+        request.name = item_map.at("name").AsString();
+        request.latitude = item_map.at("latitude").AsDouble();
+        request.longitude = item_map.at("longitude").AsDouble();
+        if (const auto it = item_map.find("road_distances"); it != item_map.end()) {
+            for (const auto& [to_name, distance_node] : it->second.AsDict()) {
+                request.road_distances.emplace_back(to_name, distance_node.AsInt());
+            }
+        }
+    } else if (request.type == "Bus") {
+        request.name = item_map.at("name").AsString();
+        request.is_roundtrip = item_map.at("is_roundtrip").AsBool();
+        for (const auto& stop_node : item_map.at("stops").AsArray()) {
+            request.stops.push_back(stop_node.AsString());
+        }
+    }
 }
 
+// Поля элемента base_requests; номер поля - номер его бита в масках BaseRequestDecoder
+constexpr std::array<std::string_view, 7> BASE_REQUEST_FIELDS = {
+    "type", "name", "latitude", "longitude", "road_distances", "is_roundtrip", "stops"
+};
+
+/*
+ * Собирает BaseRequest из событий разбора одного элемента base_requests.
+ * Строки, лежащие внутри input, не копируются, остальные копируются в arena.
+ * Закрытый элемент проверяется так же строго, как DecodeBaseRequest проверяет дерево:
+ * без обязательного поля или с полем не того типа выбрасывается json::ParsingError
+ */
+class BaseRequestDecoder final : public json::Handler {
+public:
+    BaseRequestDecoder(std::string_view input, std::pmr::memory_resource* arena)
+        : input_(input)
+        , arena_(arena)
+        , request_(arena) {
+    }
+
+    // Готовит декодер к следующему элементу; память векторов запроса переиспользуется
+    void Reset() {
+        request_.Clear();
+        depth_ = 0;
+        field_ = 0;
+        seen_ = 0;
+        invalid_ = 0;
+    }
+
+    // Запрос можно забрать перемещением, после чего нужен Reset
+    BaseRequest& GetRequest() {
+        return request_;
+    }
+
+    void Null() override {
+        Reject();
+    }
+    void Bool(bool value) override {
+        if (At(IS_ROUNDTRIP)) {
+            request_.is_roundtrip = value;
+            seen_ |= IS_ROUNDTRIP;
+        } else {
+            Reject();
+        }
+    }
+    void Int(int value) override {
+        if (In(ROAD_DISTANCES)) {
+            request_.road_distances.emplace_back(distance_to_, value);
+        } else {
+            Double(value);
+        }
+    }
+    // Дробное расстояние отвергается, как его отверг бы AsInt
+    void Double(double value) override {
+        if (At(LATITUDE)) {
+            request_.latitude = value;
+            seen_ |= LATITUDE;
+        } else if (At(LONGITUDE)) {
+            request_.longitude = value;
+            seen_ |= LONGITUDE;
+        } else {
+            Reject();
+        }
+    }
+    void String(std::string_view value) override {
+        if (At(TYPE)) {
+            request_.type = Store(value);
+            seen_ |= TYPE;
+        } else if (At(NAME)) {
+            request_.name = Store(value);
+            seen_ |= NAME;
+        } else if (In(STOPS)) {
+            request_.stops.push_back(Store(value));
+        } else {
+            Reject();
+        }
+    }
+    void StartArray() override {
+        if (At(STOPS)) {
+            seen_ |= STOPS;
+        } else {
+            Reject();
+        }
+        ++depth_;
+    }
+    void EndArray() override {
+        --depth_;
+    }
+    void StartDict() override {
+        if (At(ROAD_DISTANCES)) {
+            seen_ |= ROAD_DISTANCES;
+        } else if (depth_ > 0) {
+            Reject();
+        }
+        ++depth_;
+    }
+    void EndDict() override {
+        if (--depth_ == 0) {
+            Check();
+        }
+    }
+    void Key(std::string_view key) override {
+        if (depth_ == REQUEST_DEPTH) {
+            const auto it = std::find(BASE_REQUEST_FIELDS.begin(), BASE_REQUEST_FIELDS.end(), key);
+            field_ = it == BASE_REQUEST_FIELDS.end() ? 0 : uint8_t{1} << (it - BASE_REQUEST_FIELDS.begin());
+        } else if (depth_ == FIELD_DEPTH) {
+            distance_to_ = Store(key);
+        }
+    }
+
+private:
+    // Глубина внутри элемента: 1 - словарь запроса, 2 - road_distances или stops
+    static constexpr int REQUEST_DEPTH = 1;
+    static constexpr int FIELD_DEPTH = 2;
+
+    // Биты полей в порядке BASE_REQUEST_FIELDS
+    static constexpr uint8_t TYPE = 1 << 0;
+    static constexpr uint8_t NAME = 1 << 1;
+    static constexpr uint8_t LATITUDE = 1 << 2;
+    static constexpr uint8_t LONGITUDE = 1 << 3;
+    static constexpr uint8_t ROAD_DISTANCES = 1 << 4;
+    static constexpr uint8_t IS_ROUNDTRIP = 1 << 5;
+    static constexpr uint8_t STOPS = 1 << 6;
+
+    // Значение поля field словаря запроса
+    bool At(uint8_t field) const {
+        return depth_ == REQUEST_DEPTH && field_ == field;
+    }
+
+    // Элемент значения field: расстояние в road_distances или остановка в stops
+    bool In(uint8_t field) const {
+        return depth_ == FIELD_DEPTH && field_ == field;
+    }
+
+    // Значение не того типа портит текущее поле; неизвестные поля и их содержимое не проверяются
+    void Reject() {
+        if (depth_ == 0) {
+            throw json::ParsingError("Base request is not a dictionary");
+        }
+        if (depth_ <= FIELD_DEPTH) {
+            invalid_ |= field_;
+        }
+    }
+
+    // Поля проверяются по типу запроса, как в DecodeBaseRequest; у прочих типов нужен только type
+    void Check() const {
+        uint8_t required = TYPE;
+        uint8_t checked = TYPE;
+        if (seen_ & TYPE) {
+            if (request_.type == "Stop") {
+                required |= NAME | LATITUDE | LONGITUDE;
+                checked = required | ROAD_DISTANCES;
+            } else if (request_.type == "Bus") {
+                required |= NAME | IS_ROUNDTRIP | STOPS;
+                checked = required;
+            }
+        }
+        if (const uint8_t invalid = invalid_ & checked) {
+            throw json::ParsingError("Base request field '" + FieldName(invalid) + "' has an invalid type");
+        }
+        if (const uint8_t missing = required & ~seen_) {
+            throw json::ParsingError("Base request field '" + FieldName(missing) + "' is missing");
+        }
+    }
+
+    // Имя первого поля из маски fields
+    static std::string FieldName(uint8_t fields) {
+        return std::string(BASE_REQUEST_FIELDS[std::countr_zero(fields)]);
+    }
+
+    std::string_view Store(std::string_view str) {
+        if (str.empty() || (str.data() >= input_.data() && str.data() + str.size() <= input_.data() + input_.size())) {
+            return str;
+        }
+        char* data = static_cast<char*>(arena_->allocate(str.size(), 1));
+        std::copy(str.begin(), str.end(), data);
+        return {data, str.size()};
+    }
+
+    std::string_view input_;
+    std::pmr::memory_resource* arena_;
+    BaseRequest request_;
+    int depth_ = 0;
+    // Текущее поле словаря запроса, 0 - неизвестное; маски встреченных и испорченных полей
+    uint8_t field_ = 0;
+    uint8_t seen_ = 0;
+    uint8_t invalid_ = 0;
+    std::string_view distance_to_;
+};
+
+/*
+ * Добавляет запросы base_requests в каталог в порядке входа.
+ * Ссылки вперёд (расстояния и остановки маршрутов, объявленные позже)
+ * откладываются и разрешаются в Finish, поэтому строки запросов должны жить до её вызова
+ */
+class BaseRequestsApplier {
+public:
+    explicit BaseRequestsApplier(TransportCatalogue& catalogue)
+        : catalogue_(catalogue) {
+    }
+
+    // Отложенный автобус забирается из request перемещением
+    void Apply(BaseRequest& request) {
+        if (request.type == "Stop") {
+            catalogue_.AddStop(request.name, {request.latitude, request.longitude});
+            const Stop* from = catalogue_.FindStop(request.name);
+            for (const auto& [to_name, distance] : request.road_distances) {
+                if (const Stop* to = catalogue_.FindStop(to_name)) {
+                    catalogue_.AddDistance(from, to, distance);
+                } else {
+                    deferred_distances_.push_back({request.name, to_name, distance});
+                }
+            }
+        } else if (request.type == "Bus") {
+            // Порядок автобусов сохраняется: после первого отложенного откладываются и все следующие
+            const bool stops_known = std::all_of(request.stops.begin(), request.stops.end(),
+                                                 [this](std::string_view stop_name) {
+                                                     return catalogue_.FindStop(stop_name) != nullptr;
+                                                 });
+            if (deferred_buses_.empty() && stops_known) {
+                AddBus(request);
+            } else {
+                deferred_buses_.push_back(std::move(request));
+            }
+        }
+    }
+
+    void Finish() {
+        for (const auto& [from, to, distance] : deferred_distances_) {
+            const Stop* from_stop = catalogue_.FindStop(from);
+            const Stop* to_stop = catalogue_.FindStop(to);
+            if (from_stop && to_stop) {
+                catalogue_.AddDistance(from_stop, to_stop, distance);
+            }
+        }
+        for (const auto& bus : deferred_buses_) {
+            AddBus(bus);
+        }
+    }
+
+private:
+    struct DeferredDistance {
+        std::string_view from;
+        std::string_view to;
+        int distance;
+    };
+
+    void AddBus(const BaseRequest& bus) {
+        catalogue_.AddBus(bus.name, bus.stops, bus.is_roundtrip);
+    }
+
+    TransportCatalogue& catalogue_;
+    std::vector<DeferredDistance> deferred_distances_;
+    std::vector<BaseRequest> deferred_buses_;
+};
+
+/*
+ * Обработчик событий разбора, который передаёт элементы base_requests в каталог
+ * по мере их чтения, не строя для них дерево. Остальные секции входного
+ * документа собираются в json::ArenaDocument поверх входного буфера
+ */
+class BaseRequestsStreamer final : public json::Handler {
+public:
+    // Разбирать нужно буфер GetInput(); если input пуст, разбирается внешний буфер parse_input,
+    // который должен жить до вызова Finish
+    BaseRequestsStreamer(TransportCatalogue& catalogue, std::string input, std::string_view parse_input = {})
+        : document_builder_(std::move(input))
+        , decoder_(parse_input.empty() ? document_builder_.GetInput() : parse_input, &arena_)
+        , applier_(catalogue) {
+    }
+
+    std::string_view GetInput() const {
+        return document_builder_.GetInput();
+    }
+
+    void Null() override {
+        OnScalar(nullptr);
+    }
+    void Bool(bool value) override {
+        OnScalar(value);
+    }
+    void Int(int value) override {
+        OnScalar(value);
+    }
+    void Double(double value) override {
+        OnScalar(value);
+    }
+    void String(std::string_view value) override {
+        OnScalar(value);
+    }
+    void StartArray() override {
+        OnStart(false);
+    }
+    void EndArray() override {
+        OnEnd(false);
+    }
+    void StartDict() override {
+        OnStart(true);
+    }
+    void EndDict() override {
+        OnEnd(true);
+    }
+
+    void Key(std::string_view key) override {
+        if (capture_depth_ > 0) {
+            document_builder_.Key(key);
+        } else if (depth_ == ROOT_DEPTH) {
+            // Повторы остальных ключей обнаружит document_builder_
+            section_key_.assign(key);
+            if (section_key_ == "base_requests" && has_base_requests_) {
+                throw json::ParsingError("Duplicate key '" + section_key_ + "' have been found");
+            }
+        } else if (depth_ >= REQUEST_DEPTH) {
+            decoder_.Key(key);
+        }
+    }
+
+    // Разрешает отложенные ссылки и возвращает секции документа, кроме base_requests
+    json::ArenaDocument Finish() {
+        applier_.Finish();
+        return document_builder_.Extract();
+    }
+
+private:
+    using Scalar = std::variant<std::nullptr_t, bool, int, double, std::string_view>;
+
+    // Глубина вложенности: 1 - корневой словарь, 2 - массив base_requests,
+    // 3 - словарь запроса и глубже
+    static constexpr int ROOT_DEPTH = 1;
+    static constexpr int BASE_ARRAY_DEPTH = 2;
+    static constexpr int REQUEST_DEPTH = 3;
+
+    void OnScalar(const Scalar& value) {
+        if (capture_depth_ > 0 || depth_ < ROOT_DEPTH || !in_base_requests_) {
+            ForwardSectionKey();
+            std::visit([this](const auto& v) { Forward(document_builder_, v); }, value);
+        } else if (depth_ >= BASE_ARRAY_DEPTH) {
+            // Скаляр прямо в массиве base_requests декодер отвергнет
+            std::visit([this](const auto& v) { Forward(decoder_, v); }, value);
+        }
+    }
+
+    void OnStart(bool is_dict) {
+        if (capture_depth_ > 0) {
+            is_dict ? document_builder_.StartDict() : document_builder_.StartArray();
+            ++capture_depth_;
+            return;
+        }
+        if (depth_ == 0 && is_dict) {
+            document_builder_.StartDict();
+            ++depth_;
+            return;
+        }
+        if (depth_ == ROOT_DEPTH && section_key_ == "base_requests" && !is_dict) {
+            in_base_requests_ = true;
+            has_base_requests_ = true;
+            ++depth_;
+            return;
+        }
+        if (!in_base_requests_) {
+            ForwardSectionKey();
+            is_dict ? document_builder_.StartDict() : document_builder_.StartArray();
+            ++capture_depth_;
+            return;
+        }
+        ++depth_;
+        if (depth_ == REQUEST_DEPTH) {
+            decoder_.Reset();
+        }
+        is_dict ? decoder_.StartDict() : decoder_.StartArray();
+    }
+
+    void OnEnd(bool is_dict) {
+        if (capture_depth_ > 0) {
+            is_dict ? document_builder_.EndDict() : document_builder_.EndArray();
+            --capture_depth_;
+            return;
+        }
+        if (depth_ >= REQUEST_DEPTH) {
+            is_dict ? decoder_.EndDict() : decoder_.EndArray();
+        }
+        if (depth_ == REQUEST_DEPTH) {
+            applier_.Apply(decoder_.GetRequest());
+        } else if (depth_ == BASE_ARRAY_DEPTH) {
+            in_base_requests_ = false;
+        } else if (depth_ == ROOT_DEPTH) {
+            document_builder_.EndDict();
+        }
+        --depth_;
+    }
+
+    // Ключ секции передаётся в документ, только когда ясно, что её значение не поток base_requests
+    void ForwardSectionKey() {
+        if (capture_depth_ == 0 && depth_ == ROOT_DEPTH) {
+            document_builder_.Key(section_key_);
+        }
+    }
+
+    template <typename T>
+    static void Forward(json::Handler& handler, const T& value) {
+        if constexpr (std::is_same_v<T, std::nullptr_t>) {
+            handler.Null();
+        } else if constexpr (std::is_same_v<T, bool>) {
+            handler.Bool(value);
+        } else if constexpr (std::is_same_v<T, int>) {
+            handler.Int(value);
+        } else if constexpr (std::is_same_v<T, double>) {
+            handler.Double(value);
+        } else {
+            handler.String(value);
+        }
+    }
+
+    json::ArenaBuilder document_builder_;
+    std::pmr::monotonic_buffer_resource arena_;
+    BaseRequestDecoder decoder_;
+    BaseRequestsApplier applier_;
+    bool in_base_requests_ = false;
+    bool has_base_requests_ = false;
+    int depth_ = 0;
+    int capture_depth_ = 0;
+    std::string section_key_;
+};
+
+// Элементов в одной порции параллельного разбора
+constexpr size_t PARALLEL_CHUNK_SIZE = 2048;
+
+/*
+ * Разбирает элементы base_requests порциями в рабочих потоках, у каждого
+ * из которых свои декодер и арена. Текущий поток тем временем добавляет
+ * в каталог уже готовые порции строго в порядке входа
+ */
+class ParallelBaseRequestsParser {
+public:
+    ParallelBaseRequestsParser(std::string_view input, std::vector<std::string_view> elements, size_t workers)
+        : input_(input)
+        , elements_(std::move(elements))
+        , chunks_((elements_.size() + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE)
+        , errors_(chunks_.size())
+        , ready_(chunks_.size()) {
+        workers = std::max<size_t>(1, std::min(workers, chunks_.size()));
+        for (size_t i = 0; i < workers; ++i) {
+            arenas_.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>());
+        }
+        for (size_t i = 0; i < workers; ++i) {
+            pool_.emplace_back([this, i] { Work(*arenas_[i]); });
+        }
+    }
+
+    ~ParallelBaseRequestsParser() {
+        // Не начатые порции больше не нужны, например после ошибки
+        next_chunk_ = chunks_.size();
+    }
+
+    // Ошибка выдаётся для первой по порядку испорченной порции, как при последовательном разборе
+    void Apply(TransportCatalogue& catalogue) {
+        BaseRequestsApplier applier(catalogue);
+        for (size_t chunk = 0; chunk < chunks_.size(); ++chunk) {
+            ready_[chunk].wait(false);
+            if (errors_[chunk]) {
+                std::rethrow_exception(errors_[chunk]);
+            }
+            for (auto& request : chunks_[chunk]) {
+                applier.Apply(request);
+            }
+        }
+        applier.Finish();
+    }
+
+private:
+    void Work(std::pmr::memory_resource& arena) {
+        BaseRequestDecoder decoder(input_, &arena);
+        for (size_t chunk = next_chunk_++; chunk < chunks_.size(); chunk = next_chunk_++) {
+            try {
+                const size_t end = std::min(elements_.size(), (chunk + 1) * PARALLEL_CHUNK_SIZE);
+                auto& requests = chunks_[chunk];
+                requests.reserve(end - chunk * PARALLEL_CHUNK_SIZE);
+                for (size_t i = chunk * PARALLEL_CHUNK_SIZE; i < end; ++i) {
+                    decoder.Reset();
+                    json::Parse(elements_[i], decoder);
+                    requests.push_back(std::move(decoder.GetRequest()));
+                }
+            } catch (...) {
+                errors_[chunk] = std::current_exception();
+            }
+            ready_[chunk] = true;
+            ready_[chunk].notify_one();
+        }
+    }
+
+    std::string_view input_;
+    std::vector<std::string_view> elements_;
+    // Арены объявлены раньше порций, чтобы пережить запросы, размещённые в них
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas_;
+    std::vector<std::vector<BaseRequest>> chunks_;
+    std::vector<std::exception_ptr> errors_;
+    std::vector<std::atomic<bool>> ready_;
+    std::atomic<size_t> next_chunk_ = 0;
+    // Потоки объявлены последними и завершаются первыми, пока остальные поля ещё живы
+    std::vector<std::jthread> pool_;
+};
+
+enum class StatRequestKind : uint8_t {
+    BUS,
+    STOP,
+    ROUTE,
+    SEARCH,
+    MAP,
+    STATS
+};
+
+std::optional<StatRequestKind> ParseStatRequestKind(std::string_view type) {
+    if (type == "Bus") {
+        return StatRequestKind::BUS;
+    } else if (type == "Stop") {
+        return StatRequestKind::STOP;
+    } else if (type == "Route") {
+        return StatRequestKind::ROUTE;
+    } else if (type == "Search") {
+        return StatRequestKind::SEARCH;
+    } else if (type == "Map") {
+        return StatRequestKind::MAP;
+    } else if (type == "Stats") {
+        return StatRequestKind::STATS;
+    }
+    return std::nullopt;
+}
+
+// Элемент stat_requests. Строки указывают в документ; заполнены только поля своего вида
+struct StatRequest {
+    StatRequestKind kind = StatRequestKind::BUS;
+    int id = 0;
+    std::string_view name;  // Bus, Stop
+    std::string_view from;  // Route
+    std::string_view to;
+    std::string_view query; // Search
+    size_t limit = 10;
+    size_t max_edits = 0;
+    std::string_view error; // Search, Map: почему запрос отклонён, если параметры недопустимы
+    std::optional<renderer::Viewport> viewport; // Map: область карты
+    std::optional<renderer::Tile> tile;         // Map: плитка z/x/y
+    std::optional<double> simplify_tolerance;   // Map: допуск упрощения вместо заданного в настройках
+};
+
+// Больше правок нечёткий поиск не допускает: при таком бюджете подходит почти любое имя
+constexpr size_t MAX_SEARCH_EDITS = 3;
+
+// Область карты [min_x, min_y, max_x, max_y]; nullopt - значение другого вида
+std::optional<renderer::Viewport> DecodeViewport(const json::ArenaNode& node) {
+    if (!node.IsArray()) {
+        return std::nullopt;
+    }
+    const auto& bounds = node.AsArray();
+    if (bounds.size() != 4 || !std::all_of(bounds.begin(), bounds.end(), [](const auto& bound) {
+            return bound.IsDouble();
+        })) {
+        return std::nullopt;
+    }
+    return renderer::Viewport{bounds[0].AsDouble(), bounds[1].AsDouble(), bounds[2].AsDouble(), bounds[3].AsDouble()};
+}
+
+// Плитка {"z", "x", "y"} с целыми номерами; nullopt - значение другого вида
+std::optional<renderer::Tile> DecodeTile(const json::ArenaNode& node) {
+    if (!node.IsDict()) {
+        return std::nullopt;
+    }
+    const auto& tile = node.AsDict();
+    int coordinates[3];
+    for (size_t i = 0; const std::string_view key : {"z", "x", "y"}) {
+        const auto it = tile.find(key);
+        if (it == tile.end() || !it->second.IsInt()) {
+            return std::nullopt;
+        }
+        coordinates[i++] = it->second.AsInt();
+    }
+    return renderer::Tile{coordinates[0], coordinates[1], coordinates[2]};
+}
+
+// Разбирает stat_requests за один проход; запросы неизвестных типов пропускаются
+std::vector<StatRequest> DecodeStatRequests(json::ArenaArray items) {
+    std::vector<StatRequest> requests;
+    requests.reserve(items.size());
+    for (const auto& item : items) {
+        const auto& item_map = item.AsDict();
+        const int id = item_map.at("id").AsInt();
+        const auto kind = ParseStatRequestKind(item_map.at("type").AsString());
+        if (!kind) {
+            continue;
+        }
+
+        StatRequest& request = requests.emplace_back();
+        request.kind = *kind;
+        request.id = id;
+        switch (*kind) {
+        case StatRequestKind::BUS:
+        case StatRequestKind::STOP:
+            request.name = item_map.at("name").AsString();
+            break;
+        case StatRequestKind::ROUTE:
+            request.from = item_map.at("from").AsString();
+            request.to = item_map.at("to").AsString();
+            break;
+        case StatRequestKind::SEARCH:
+            request.query = item_map.at("query").AsString();
+            if (const auto limit_it = item_map.find("limit"); limit_it != item_map.end()) {
+                const int limit = limit_it->second.AsInt();
+                if (limit < 0) {
+                    request.error = "negative limit";
+                }
+                request.limit = static_cast<size_t>(std::max(limit, 0));
+            }
+            if (const auto edits_it = item_map.find("max_edits"); edits_it != item_map.end()) {
+                const int max_edits = edits_it->second.AsInt();
+                if (max_edits < 0) {
+                    request.error = "negative max_edits";
+                }
+                request.max_edits = std::min(static_cast<size_t>(std::max(max_edits, 0)), MAX_SEARCH_EDITS);
+            }
+            break;
+        case StatRequestKind::MAP:
+            // Недопустимые параметры отклоняют только этот запрос, остальные ответы выводятся
+            if (const auto viewport_it = item_map.find("viewport"); viewport_it != item_map.end()) {
+                request.viewport = DecodeViewport(viewport_it->second);
+                if (!request.viewport) {
+                    request.error = "invalid viewport";
+                }
+            } else if (const auto tile_it = item_map.find("tile"); tile_it != item_map.end()) {
+                request.tile = DecodeTile(tile_it->second);
+                if (!request.tile) {
+                    request.error = "invalid tile";
+                }
+            }
+            if (const auto tolerance_it = item_map.find("simplify_tolerance"); tolerance_it != item_map.end()) {
+                if (tolerance_it->second.IsDouble()) {
+                    request.simplify_tolerance = tolerance_it->second.AsDouble();
+                } else {
+                    request.error = "invalid simplify_tolerance";
+                }
+            }
+            break;
+        case StatRequestKind::STATS:
+            break;
+        }
+    }
+    return requests;
+}
+
+// Запросов в одном окне StatRequestsResponder: ответы окна хранятся до вывода
+constexpr size_t STAT_WINDOW_SIZE = 1024;
+
+/*
+ * Отвечает на stat_requests окнами: внутри окна запросы одного вида
+ * выполняются подряд (индексы каталога и маршрутизатора остаются в кэше),
+ * а ответы затем выводятся в исходном порядке. Карта берётся из кэша,
+ * настройки отрисовки разбираются один раз. StreamBuilder пишет ключи в порядке вызовов,
+ * поэтому они перечислены по алфавиту
+ */
+class StatRequestsResponder {
+public:
+    StatRequestsResponder(const JsonReader& reader, const TransportCatalogue& catalogue,
+                          renderer::MapCache& map_cache, json::ArrayWriter& writer)
+        : reader_(reader)
+        , catalogue_(catalogue)
+        , map_cache_(map_cache)
+        , writer_(writer) {
+    }
+
+    void Process(std::span<const StatRequest> window) {
+        order_.resize(window.size());
+        std::iota(order_.begin(), order_.end(), size_t{0});
+        std::stable_sort(order_.begin(), order_.end(), [window](size_t lhs, size_t rhs) {
+            return window[lhs].kind < window[rhs].kind;
+        });
+
+        results_.clear();
+        results_.resize(window.size());
+        for (const size_t i : order_) {
+            results_[i] = Resolve(window[i]);
+        }
+
+        for (size_t i = 0; i < window.size(); ++i) {
+            json::StreamBuilder builder(writer_);
+            Write(builder, window[i], results_[i]);
+            builder.Build();
+        }
+    }
+
+    static void WriteBus(json::StreamBuilder& builder, int id, const std::optional<TransportCatalogue::BusInfo>& bus_info) {
+        builder.StartDict();
+        if (bus_info) {
+            builder.Key("curvature").Value(bus_info->curvature)
+                  .Key("request_id").Value(id)
+                  .Key("route_length").Value(bus_info->route_length)
+                  .Key("stop_count").Value(static_cast<int>(bus_info->stops_count))
+                  .Key("unique_stop_count").Value(static_cast<int>(bus_info->unique_stops));
+        } else {
+            builder.Key("error_message").Value("not found")
+                  .Key("request_id").Value(id);
+        }
+        builder.EndDict();
+    }
+
+    // buses - имена автобусов остановки по алфавиту; nullptr - остановки нет
+    template <typename Names>
+    static void WriteStop(json::StreamBuilder& builder, int id, const Names* buses) {
+        builder.StartDict();
+        if (buses) {
+            builder.Key("buses").StartArray();
+            for (const auto& bus : *buses) {
+                builder.Value(bus);
+            }
+            builder.EndArray();
+        } else {
+            builder.Key("error_message").Value("not found");
+        }
+        builder.Key("request_id").Value(id).EndDict();
+    }
+
+private:
+    struct SearchResult {
+        std::vector<std::string_view> buses;
+        std::vector<std::string_view> stops;
+    };
+
+    struct StatsResult {
+        AllocationStats arena;
+        TransportCatalogue::MemoryStats catalogue;
+        TransportRouter::MemoryStats router;
+        renderer::MapCache::MemoryStats map;
+        size_t router_table_projection = 0;
+    };
+
+    // Ответ на Map - готовая строка JSON из кэша полной карты либо отдельно отрисованный SVG
+    // (область, другой допуск упрощения); monostate - плитка вне уровня или недопустимые параметры запроса
+    using Result = std::variant<std::monostate,
+                                std::optional<TransportCatalogue::BusInfo>,
+                                std::optional<set_names>,
+                                std::optional<RouteInfo>,
+                                std::string_view,
+                                std::string,
+                                SearchResult,
+                                StatsResult>;
+
+    Result Resolve(const StatRequest& request) {
+        switch (request.kind) {
+        case StatRequestKind::BUS:
+            return catalogue_.GetBusInfo(request.name);
+        case StatRequestKind::STOP:
+            return catalogue_.GetBusesByStopName(request.name);
+        case StatRequestKind::ROUTE:
+            return catalogue_.FindRoute(request.from, request.to);
+        case StatRequestKind::SEARCH: {
+            if (!request.error.empty()) {
+                return std::monostate{};
+            }
+            const auto search = [&request](const NameIndex& index) {
+                return request.max_edits == 0 ? index.FindByPrefix(request.query, request.limit)
+                                              : index.FindFuzzy(request.query, request.max_edits, request.limit);
+            };
+            return SearchResult{search(catalogue_.GetBusNameIndex()), search(catalogue_.GetStopNameIndex())};
+        }
+        case StatRequestKind::MAP:
+            if (!request.error.empty()) {
+                return std::monostate{};
+            }
+            if (request.viewport || request.tile) {
+                return ResolveArea(request);
+            }
+            if (request.simplify_tolerance
+                && *request.simplify_tolerance != GetRenderSettings().simplify_tolerance_.value_or(0)) {
+                // Отдельная строка: кэш хранит одну карту, а на неё могут ссылаться ответы окна
+                renderer::RenderSettings settings = GetRenderSettings();
+                settings.simplify_tolerance_ = request.simplify_tolerance;
+                return map_cache_.Render(catalogue_, settings);
+            }
+            // Каталог не меняется во время ответов, поэтому строка из кэша остаётся действительной
+            return map_cache_.GetJson(catalogue_, GetRenderSettings());
+        case StatRequestKind::STATS:
+            return ResolveStats();
+        }
+        return std::monostate{};
+    }
+
+    const renderer::RenderSettings& GetRenderSettings() {
+        if (!render_settings_) {
+            render_settings_ = reader_.ParseRenderSettings();
+        }
+        return *render_settings_;
+    }
+
+    Result ResolveArea(const StatRequest& request) {
+        const renderer::RenderSettings& settings = GetRenderSettings();
+        renderer::Viewport viewport;
+        if (request.viewport) {
+            viewport = *request.viewport;
+        } else {
+            try {
+                viewport = renderer::TileViewport(settings, *request.tile);
+            } catch (const std::out_of_range&) {
+                return std::monostate{};
+            }
+        }
+        std::string svg;
+        map_cache_.GetIndex(catalogue_, settings).Render(viewport, svg);
+        return svg;
+    }
+
+    StatsResult ResolveStats() {
+        // Карта не рисуется ради отчёта: сообщается то, что уже лежит в кэше ответов Map
+        return {catalogue_.GetAllocationStats(), catalogue_.GetMemoryStats(), catalogue_.GetRouter().GetMemoryStats(),
+                map_cache_.GetMemoryStats(), catalogue_.EstimateRouterTableBytes()};
+    }
+
+    void Write(json::StreamBuilder& builder, const StatRequest& request, const Result& result) const {
+        const int id = request.id;
+        switch (request.kind) {
+        case StatRequestKind::BUS:
+            WriteBus(builder, id, std::get<std::optional<TransportCatalogue::BusInfo>>(result));
+            break;
+        case StatRequestKind::STOP:
+            WriteStop(builder, id, std::get<std::optional<set_names>>(result).value_or(nullptr));
+            break;
+        case StatRequestKind::ROUTE:
+            WriteRoute(builder, id, std::get<std::optional<RouteInfo>>(result));
+            break;
+        case StatRequestKind::SEARCH:
+            if (const auto* search = std::get_if<SearchResult>(&result)) {
+                WriteSearch(builder, id, *search);
+            } else {
+                builder.StartDict()
+                    .Key("error_message").Value(request.error)
+                    .Key("request_id").Value(id)
+                    .EndDict();
+            }
+            break;
+        case StatRequestKind::MAP:
+            WriteMap(builder, request, result);
+            break;
+        case StatRequestKind::STATS:
+            WriteStats(builder, id, std::get<StatsResult>(result));
+            break;
+        }
+    }
+
+    static void WriteMap(json::StreamBuilder& builder, const StatRequest& request, const Result& result) {
+        builder.StartDict();
+        if (const auto* full = std::get_if<std::string_view>(&result)) {
+            builder.Key("map").RawValue(*full);
+        } else if (const auto* area = std::get_if<std::string>(&result)) {
+            builder.Key("map").Value(std::string_view(*area));
+        } else {
+            // Без ошибки разбора пустой результат - плитка за пределами своего уровня
+            builder.Key("error_message").Value(request.error.empty() ? std::string_view("invalid tile") : request.error);
+        }
+        builder.Key("request_id").Value(request.id).EndDict();
+    }
+
+    static void WriteRoute(json::StreamBuilder& builder, int id, const std::optional<RouteInfo>& route_info) {
+        builder.StartDict();
+        if (route_info) {
+            builder.Key("items").StartArray();
+            for (const auto& item : route_info->items) {
+                if (std::holds_alternative<std::pair<std::string, double>>(item)) {
+                    const auto& wait_item = std::get<std::pair<std::string, double>>(item);
+                    builder.StartDict()
+                          .Key("stop_name").Value(wait_item.first)
+                          .Key("time").Value(wait_item.second)
+                          .Key("type").Value("Wait")
+                          .EndDict();
+                } else {
+                    const auto& bus_item = std::get<std::tuple<std::string, std::string, int, double>>(item);
+                    builder.StartDict()
+                          .Key("bus").Value(std::get<0>(bus_item))
+                          .Key("span_count").Value(std::get<2>(bus_item))
+                          .Key("time").Value(std::get<3>(bus_item))
+                          .Key("type").Value("Bus")
+                          .EndDict();
+                }
+            }
+            builder.EndArray()
+                  .Key("request_id").Value(id)
+                  .Key("total_time").Value(route_info->total_time);
+        } else {
+            builder.Key("error_message").Value("not found")
+                  .Key("request_id").Value(id);
+        }
+        builder.EndDict();
+    }
+
+    static void WriteSearch(json::StreamBuilder& builder, int id, const SearchResult& search) {
+        builder.StartDict().Key("buses").StartArray();
+        for (const auto name : search.buses) {
+            builder.Value(name);
+        }
+        builder.EndArray()
+            .Key("request_id").Value(id)
+            .Key("stops").StartArray();
+        for (const auto name : search.stops) {
+            builder.Value(name);
+        }
+        builder.EndArray().EndDict();
+    }
+
+    static void WriteStats(json::StreamBuilder& builder, int id, const StatsResult& stats) {
+        builder.StartDict()
+            .Key("arena").StartDict()
+                .Key("allocations").Value(SizeToNode(stats.arena.allocations))
+                .Key("bytes").Value(SizeToNode(stats.arena.bytes))
+                .Key("upstream_allocations").Value(SizeToNode(stats.arena.upstream_allocations))
+                .Key("upstream_bytes").Value(SizeToNode(stats.arena.upstream_bytes))
+            .EndDict()
+            .Key("catalogue").StartDict();
+        WriteUsage(builder, "bus_index", stats.catalogue.bus_index);
+        WriteUsage(builder, "bus_stops", stats.catalogue.bus_stops);
+        WriteUsage(builder, "buses", stats.catalogue.buses);
+        WriteUsage(builder, "distances", stats.catalogue.distances);
+        WriteUsage(builder, "names", stats.catalogue.names);
+        WriteUsage(builder, "retired", stats.catalogue.retired);
+        WriteUsage(builder, "stop_buses", stats.catalogue.stop_buses);
+        WriteUsage(builder, "stop_index", stats.catalogue.stop_index);
+        WriteUsage(builder, "stops", stats.catalogue.stops);
+        builder.EndDict();
+        builder.Key("map").StartDict();
+        WriteUsage(builder, "index", stats.map.index);
+        WriteUsage(builder, "json", stats.map.json);
+        WriteUsage(builder, "model", stats.map.model);
+        WriteUsage(builder, "route_lod", stats.map.route_lod);
+        WriteUsage(builder, "svg", stats.map.svg);
+        builder.EndDict()
+            .Key("request_id").Value(id)
+            .Key("router").StartDict();
+        WriteUsage(builder, "edge_info", stats.router.edge_info);
+        WriteUsage(builder, "graph", stats.router.graph);
+        WriteUsage(builder, "table", stats.router.table);
+        WriteUsage(builder, "vertex_index", stats.router.vertex_index);
+        builder.EndDict()
+            .Key("router_table_projection").Value(SizeToNode(stats.router_table_projection))
+        .EndDict();
+    }
+
+    const JsonReader& reader_;
+    const TransportCatalogue& catalogue_;
+    renderer::MapCache& map_cache_;
+    json::ArrayWriter& writer_;
+    std::optional<renderer::RenderSettings> render_settings_;
+    std::vector<size_t> order_;
+    std::vector<Result> results_;
+};
+
+} // namespace
+
+JsonReader::JsonReader() = default;
+
 void JsonReader::Input(std::istream &in) {
-    document_ = json::Load(in);
+    // Вход читается целиком и разбирается из буфера: это быстрее посимвольного чтения из потока.
+    // Буфер остаётся у документа, и строки документа указывают прямо в него
+    document_ = json::LoadArena(ReadAll(in));
+}
+
+void JsonReader::InputStreaming(std::istream &in, TransportCatalogue &catalogue) {
+    BaseRequestsStreamer streamer(catalogue, ReadAll(in));
+    json::Parse(streamer.GetInput(), streamer);
+    document_ = streamer.Finish();
+}
+
+void JsonReader::InputStreaming(std::string_view input, TransportCatalogue &catalogue) {
+    // Чужой буфер: строки документа копируются в его арену
+    BaseRequestsStreamer streamer(catalogue, {}, input);
+    json::Parse(input, streamer);
+    document_ = streamer.Finish();
+}
+
+void JsonReader::InputParallel(std::istream &in, TransportCatalogue &catalogue, size_t threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    std::string input = ReadAll(in);
+    const auto base_requests = json::FindRootMember(input, "base_requests");
+    // Без второго ядра или массива для деления на части достаточно обычного потокового разбора,
+    // он же сообщит об ошибках структуры
+    if (threads < 2 || !base_requests || !base_requests->starts_with('[')) {
+        BaseRequestsStreamer streamer(catalogue, std::move(input));
+        json::Parse(streamer.GetInput(), streamer);
+        document_ = streamer.Finish();
+        return;
+    }
+
+    // Текущий поток добавляет запросы в каталог, остальные разбирают
+    ParallelBaseRequestsParser parser(input, json::SplitArray(*base_requests), threads - 1);
+
+    // Остальные секции разбираются из копии входа, где base_requests заменён пустым массивом
+    const size_t offset = base_requests->data() - input.data();
+    std::string rest;
+    rest.reserve(input.size() - base_requests->size() + 2);
+    rest.append(input, 0, offset).append("[]").append(input, offset + base_requests->size());
+    document_ = json::LoadArena(std::move(rest));
+
+    parser.Apply(catalogue);
 }
 
 renderer::RenderSettings JsonReader::ParseRenderSettings() const {
@@ -38,7 +1120,7 @@ renderer::RenderSettings JsonReader::ParseRenderSettings() const {
         settings.stop_label_offset_ = {stop_label_offset[0].AsDouble(), stop_label_offset[1].AsDouble()};
         const auto& underlayer_color = render_settings.at("underlayer_color");
         if (underlayer_color.IsString()) {
-            settings.underlayer_color_ = underlayer_color.AsString();
+            settings.underlayer_color_ = std::string(underlayer_color.AsString());
         } else if (underlayer_color.IsArray()) {
             const auto& color_array = underlayer_color.AsArray();
             if (color_array.size() == 3) {
@@ -58,9 +1140,18 @@ renderer::RenderSettings JsonReader::ParseRenderSettings() const {
         }
 
         settings.underlayer_width_ = render_settings.at("underlayer_width").AsDouble();
+        if (const auto precision_it = render_settings.find("coordinate_precision"); precision_it != render_settings.end()) {
+            settings.coordinate_precision_ = precision_it->second.AsInt();
+        }
+        if (const auto tolerance_it = render_settings.find("simplify_tolerance"); tolerance_it != render_settings.end()) {
+            settings.simplify_tolerance_ = tolerance_it->second.AsDouble();
+        }
+        if (const auto compact_it = render_settings.find("compact_svg"); compact_it != render_settings.end()) {
+            settings.compact_svg_ = compact_it->second.AsBool();
+        }
         for (const auto& color_node : render_settings.at("color_palette").AsArray()) {
             if (color_node.IsString()) {
-                settings.color_palette_.emplace_back(color_node.AsString());
+                settings.color_palette_.emplace_back(std::string(color_node.AsString()));
             } else if (color_node.IsArray()) {
                 const auto& color_array = color_node.AsArray();
                 if (color_array.size() == 3) {
@@ -91,149 +1182,208 @@ void JsonReader::ParseRoutingSettings(transport::TransportCatalogue &catalogue)
     }
 }
 
+json::PrintOptions JsonReader::ParseOutputSettings() const {
+    json::PrintOptions options;
+    const auto& root_map = document_.GetRoot().AsDict();
+    if (const auto it = root_map.find("output_settings"); it != root_map.end()) {
+        const auto& map = it->second.AsDict();
+        if (const auto compact_it = map.find("compact"); compact_it != map.end()) {
+            options.compact = compact_it->second.AsBool();
+        }
+        if (const auto precision_it = map.find("precision"); precision_it != map.end()) {
+            if (precision_it->second.IsNull()) {
+                options.precision.reset();
+            } else {
+                options.precision = precision_it->second.AsInt();
+            }
+        }
+    }
+    return options;
+}
+
+bool JsonReader::HasRenderSettings() const {
+    return document_.GetRoot().AsDict().count("render_settings") > 0;
+}
+
+// Каждый элемент разбирается один раз и сразу добавляется в каталог;
+// ссылки на объявленные ниже остановки разрешаются в конце
 void JsonReader::BaseRequestsProcessing(TransportCatalogue &catalogue) const {
     const auto& root_map = document_.GetRoot().AsDict();
 
     if (const auto it = root_map.find("base_requests"); it != root_map.end()) {
+        BaseRequestsApplier applier(catalogue);
+        BaseRequest request;
         for (const auto& item : it->second.AsArray()) {
-            const auto& item_map = item.AsDict();
-            if (item_map.at("type").AsString() == "Stop") {
-                std::string stop_name(item_map.at("name").AsString());
-                double latitude = item_map.at("latitude").AsDouble();
-                double longitude = item_map.at("longitude").AsDouble();
-                catalogue.AddStop(stop_name, {latitude, longitude});
+            DecodeBaseRequest(item.AsDict(), request);
+            applier.Apply(request);
+        }
+        applier.Finish();
+    }
+}
+
+// delta_requests применяются в том же порядке, что и base_requests:
+// остановки, расстояния, автобусы, и лишь затем удаление остановок,
+// чтобы патч мог сначала перенаправить автобусы с удаляемой остановки.
+// Элемент, который не удалось применить, отклоняется с сообщением в std::cerr
+// и в следующих проходах пропускается; остальные элементы применяются
+TransportCatalogue::Invalidation JsonReader::DeltaRequestsProcessing(TransportCatalogue &catalogue) {
+    TransportCatalogue::Invalidation invalidation;
+    const auto& root_map = document_.GetRoot().AsDict();
+    const auto it = root_map.find("delta_requests");
+    if (it == root_map.end()) {
+        return invalidation;
+    }
+
+    const json::ArenaArray items = it->second.AsArray();
+    std::vector<bool> rejected(items.size());
+    const auto for_each_item = [&items, &rejected](const auto& apply) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (rejected[i]) {
+                continue;
+            }
+            try {
+                apply(items[i].AsDict());
+            } catch (const std::exception& e) {
+                rejected[i] = true;
+                std::cerr << "delta_requests[" << i << "] rejected: " << e.what() << '\n';
             }
         }
+    };
 
-        for (const auto& item : it->second.AsArray()) {
-            const auto& item_map = item.AsDict();
-            if (item_map.at("type").AsString() == "Stop") {
-                std::string from_stop_name(item_map.at("name").AsString());
-                const transport::Stop* from = catalogue.FindStop(from_stop_name);
-                if (from && item_map.count("road_distances")) {
-                    for (const auto& [to_name, distance_node] : item_map.at("road_distances").AsDict()) {
-                        const transport::Stop* to = catalogue.FindStop(to_name);
-                        if (to) {
-                            catalogue.AddDistance(from, to, distance_node.AsInt());
-                        }
-                    }
-                }
+    const auto is_removal = [](const json::ArenaDict& item_map) {
+        const auto remove_it = item_map.find("remove");
+        return remove_it != item_map.end() && remove_it->second.AsBool();
+    };
+
+    for_each_item([&](const json::ArenaDict& item_map) {
+        if (item_map.at("type").AsString() == "Stop" && !is_removal(item_map)) {
+            invalidation |= catalogue.UpsertStop(item_map.at("name").AsString(),
+                                                 {item_map.at("latitude").AsDouble(), item_map.at("longitude").AsDouble()});
+        }
+    });
+
+    for_each_item([&](const json::ArenaDict& item_map) {
+        const auto& type = item_map.at("type").AsString();
+        if (type == "Stop" && !is_removal(item_map) && item_map.count("road_distances")) {
+            for (const auto& [to_name, distance_node] : item_map.at("road_distances").AsDict()) {
+                invalidation |= catalogue.SetDistance(item_map.at("name").AsString(), to_name, distance_node.AsInt());
             }
+        } else if (type == "Distance") {
+            invalidation |= catalogue.SetDistance(item_map.at("from").AsString(), item_map.at("to").AsString(),
+                                                  item_map.at("distance").AsInt());
         }
+    });
 
-        for (const auto& item : it->second.AsArray()) {
-            const auto& item_map = item.AsDict();
-            if (item_map.at("type").AsString() == "Bus") {
-                std::string name = item_map.at("name").AsString();
-                bool is_roundtrip = item_map.at("is_roundtrip").AsBool();
-                std::vector<std::string_view> stop_names;
-                for (const auto& stop_node : item_map.at("stops").AsArray()) {
-                    stop_names.push_back(stop_node.AsString());
-                }
-                catalogue.AddBus(name, stop_names, is_roundtrip);
+    std::vector<std::string_view> stop_names;
+    for_each_item([&](const json::ArenaDict& item_map) {
+        if (item_map.at("type").AsString() != "Bus") {
+            return;
+        }
+        if (is_removal(item_map)) {
+            invalidation |= catalogue.RemoveBus(item_map.at("name").AsString());
+        } else {
+            stop_names.clear();
+            for (const auto& stop_node : item_map.at("stops").AsArray()) {
+                stop_names.push_back(stop_node.AsString());
             }
+            invalidation |= catalogue.UpsertBus(item_map.at("name").AsString(), stop_names,
+                                                item_map.at("is_roundtrip").AsBool());
+        }
+    });
+
+    for_each_item([&](const json::ArenaDict& item_map) {
+        if (item_map.at("type").AsString() == "Stop" && is_removal(item_map)) {
+            invalidation |= catalogue.RemoveStop(item_map.at("name").AsString());
         }
+    });
+
+    // Кэш карты и так проверяет версию каталога, но устаревшие SVG и модель незачем держать в памяти
+    if (invalidation.map) {
+        map_cache_.Clear();
     }
+    return invalidation;
 }
 
-void JsonReader::StatRequestsProcessing(TransportCatalogue &catalogue) const {
+renderer::MapCache::Stats JsonReader::GetMapCacheStats() const {
+    return map_cache_.GetStats();
+}
+
+bool JsonReader::HasDeltaRequests() const {
+    return document_.GetRoot().AsDict().count("delta_requests") > 0;
+}
+
+StatRequirements JsonReader::ScanStatRequests() const {
+    StatRequirements requirements;
     const auto& root_map = document_.GetRoot().AsDict();
     if (const auto it = root_map.find("stat_requests"); it != root_map.end()) {
-        json::Builder builder;
-        builder.StartArray();
-
         for (const auto& item : it->second.AsArray()) {
-            const auto& item_map = item.AsDict();
-            const int id = item_map.at("id").AsInt();
-            const std::string type = item_map.at("type").AsString();
-
-            if (type == "Bus") {
-                const std::string name = item_map.at("name").AsString();
-                const auto bus_info = catalogue.GetBusInfo(name);
-
-                builder.StartDict().Key("request_id").Value(id);
+            const auto kind = ParseStatRequestKind(item.AsDict().at("type").AsString());
+            if (kind && kind != StatRequestKind::BUS && kind != StatRequestKind::STOP) {
+                requirements.catalogue = true;
+            }
+            if (kind == StatRequestKind::SEARCH) {
+                requirements.name_index = true;
+            } else if (kind == StatRequestKind::ROUTE) {
+                requirements.router = true;
+            } else if (kind == StatRequestKind::MAP) {
+                requirements.render_settings = true;
+            } else if (kind == StatRequestKind::STATS) {
+                // Stats сообщает объём маршрутизатора; карту он берёт из кэша, не рисуя её
+                requirements.router = true;
+            }
+        }
+    }
+    return requirements;
+}
 
-                if (bus_info) {
-                    builder.Key("curvature").Value(bus_info->curvature)
-                          .Key("route_length").Value(bus_info->route_length)
-                          .Key("stop_count").Value(static_cast<int>(bus_info->stops_count))
-                          .Key("unique_stop_count").Value(static_cast<int>(bus_info->unique_stops));
-                } else {
-                    builder.Key("error_message").Value("not found");
-                }
+void JsonReader::StatRequestsProcessing(TransportCatalogue &catalogue) {
+    const auto& root_map = document_.GetRoot().AsDict();
+    if (const auto it = root_map.find("stat_requests"); it != root_map.end()) {
+        const std::vector<StatRequest> requests = DecodeStatRequests(it->second.AsArray());
 
-                builder.EndDict();
-            }
-            else if (type == "Stop") {
-                const std::string name = item_map.at("name").AsString();
-                const auto buses = catalogue.GetBusesByStopName(name);
+        // Ответы выводятся окнами по мере готовности, а не собираются в общий массив
+        json::ArrayWriter writer(std::cout, 64, ParseOutputSettings());
+        StatRequestsResponder responder(*this, catalogue, map_cache_, writer);
+        for (size_t start = 0; start < requests.size(); start += STAT_WINDOW_SIZE) {
+            const size_t size = std::min(STAT_WINDOW_SIZE, requests.size() - start);
+            responder.Process(std::span<const StatRequest>(requests).subspan(start, size));
+        }
 
-                builder.StartDict().Key("request_id").Value(id);
+        writer.Finish();
+    }
+}
 
-                if (buses) {
-                    builder.Key("buses").StartArray();
-                    for (const auto& bus : *buses.value()) {
-                        builder.Value(std::string(bus));
-                    }
-                    builder.EndArray();
-                } else {
-                    builder.Key("error_message").Value("not found");
-                }
+void JsonReader::StatRequestsProcessing(const snapshot::MappedCatalogue& snapshot) const {
+    const auto& root_map = document_.GetRoot().AsDict();
+    if (const auto it = root_map.find("stat_requests"); it != root_map.end()) {
+        const std::vector<StatRequest> requests = DecodeStatRequests(it->second.AsArray());
 
-                builder.EndDict();
-            }
-            else if (type == "Map") {
-                renderer::RenderSettings settings = ParseRenderSettings();
-                renderer::MapRenderer mapRenderer;
-                mapRenderer.SetSettings(settings);
-                svg::Document doc = mapRenderer.RenderMap(catalogue);
-                std::ostringstream oss;
-                doc.Render(oss);
-                builder.StartDict()
-                .Key("request_id").Value(id)
-                .Key("map").Value(oss.str())
-                .EndDict();
-            }
-            else if (type == "Route") {
-                const std::string from = item_map.at("from").AsString();
-                const std::string to = item_map.at("to").AsString();
-
-                builder.StartDict().Key("request_id").Value(id);
-
-                if (auto route_info = catalogue.FindRoute(from, to)) {
-                    builder.Key("total_time").Value(route_info->total_time)
-                          .Key("items").StartArray();
-
-                    for (const auto& item : route_info->items) {
-                        if (std::holds_alternative<std::pair<std::string, double>>(item)) {
-                            const auto& wait_item = std::get<std::pair<std::string, double>>(item);
-                            builder.StartDict()
-                                  .Key("type").Value("Wait")
-                                  .Key("stop_name").Value(wait_item.first)
-                                  .Key("time").Value(wait_item.second)
-                                  .EndDict();
-                        } else {
-                            const auto& bus_item = std::get<std::tuple<std::string, std::string, int, double>>(item);
-                            builder.StartDict()
-                                  .Key("type").Value("Bus")
-                                  .Key("bus").Value(std::get<0>(bus_item))
-                                  .Key("span_count").Value(std::get<2>(bus_item))
-                                  .Key("time").Value(std::get<3>(bus_item))
-                                  .EndDict();
-                        }
+        json::ArrayWriter writer(std::cout, 64, ParseOutputSettings());
+        std::vector<std::string_view> bus_names;
+        for (const StatRequest& request : requests) {
+            json::StreamBuilder builder(writer);
+            switch (request.kind) {
+            case StatRequestKind::BUS:
+                StatRequestsResponder::WriteBus(builder, request.id, snapshot.GetBusInfo(request.name));
+                break;
+            case StatRequestKind::STOP:
+                if (const auto buses = snapshot.GetBusesByStopName(request.name)) {
+                    bus_names.clear();
+                    for (const snapshot::BusId bus : *buses) {
+                        bus_names.push_back(snapshot.GetBusName(bus));
                     }
-
-                    builder.EndArray();
+                    StatRequestsResponder::WriteStop(builder, request.id, &bus_names);
                 } else {
-                    builder.Key("error_message").Value("not found");
+                    StatRequestsResponder::WriteStop(builder, request.id, static_cast<decltype(&bus_names)>(nullptr));
                 }
-
-                builder.EndDict();
+                break;
+            default:
+                throw std::logic_error("Only Bus and Stop requests are served from a snapshot");
             }
+            builder.Build();
         }
 
-        builder.EndArray();
-        json::Print(json::Document{builder.Build()}, std::cout);
+        writer.Finish();
     }
 }
-} // namespace transport
\ No newline at end of file
+} // namespace transport
@@ -2,21 +2,52 @@
 
 #include "transport_catalogue.h"
 #include "json.h"
+#include "json_arena.h"
 #include "map_renderer.h"
+#include "snapshot.h"
 
 namespace transport {
 
+    // Подготовительные этапы, без которых не ответить на stat_requests
+    struct StatRequirements {
+        bool name_index = false;      // Search
+        bool router = false;          // Route, Stats
+        bool render_settings = false; // Map
+        bool catalogue = false;       // всё, кроме Bus и Stop: из снимка без каталога не ответить
+    };
+
     class JsonReader {
     public:
         JsonReader();
         void Input(std::istream& in);
+        // Читает вход, передавая base_requests в каталог по мере разбора, без построения дерева для них.
+        // Остальные секции сохраняются в документе, BaseRequestsProcessing после этого не нужен
+        void InputStreaming(std::istream& in, transport::TransportCatalogue& catalogue);
+        void InputStreaming(std::string_view input, transport::TransportCatalogue& catalogue);
+        // Как InputStreaming, но элементы base_requests разбираются параллельно в threads потоках
+        // (0 - по числу ядер) и добавляются в каталог в порядке входа. При одном потоке равен InputStreaming
+        void InputParallel(std::istream& in, transport::TransportCatalogue& catalogue, size_t threads = 0);
         void BaseRequestsProcessing(transport::TransportCatalogue& catalogue) const;
-        void StatRequestsProcessing(transport::TransportCatalogue& catalogue) const;
+        // Применяет delta_requests; ошибочные элементы отклоняются по одному. Возвращает производные
+        // структуры, которые нужно перестроить; кэш карты при изменении карты сбрасывается здесь же
+        TransportCatalogue::Invalidation DeltaRequestsProcessing(transport::TransportCatalogue& catalogue);
+        // Ответы на Map берутся из кэша карты, который переживает вызовы и сбрасывается при изменении каталога
+        void StatRequestsProcessing(transport::TransportCatalogue& catalogue);
+        // Отвечает прямо из отображённого снимка; годится, только если в stat_requests лишь Bus и Stop
+        void StatRequestsProcessing(const snapshot::MappedCatalogue& snapshot) const;
+        // Просматривает только типы stat_requests, чтобы пропустить ненужные этапы подготовки
+        [[nodiscard]] StatRequirements ScanStatRequests() const;
+        [[nodiscard]] bool HasRenderSettings() const;
+        [[nodiscard]] bool HasDeltaRequests() const;
         [[nodiscard]] renderer::RenderSettings ParseRenderSettings() const;
         void ParseRoutingSettings(transport::TransportCatalogue& catalogue) const;
+        // Необязательная секция output_settings: compact и precision (null - кратчайшая точная запись)
+        [[nodiscard]] json::PrintOptions ParseOutputSettings() const;
+        [[nodiscard]] renderer::MapCache::Stats GetMapCacheStats() const;
 
     private:
-        json::Document document_;
+        json::ArenaDocument document_;
+        renderer::MapCache map_cache_;
     };
 
 } // namespace transport
\ No newline at end of file
@@ -1,9 +1,54 @@
 #include "transport_catalogue.h"
 #include "json_reader.h"
+#include "snapshot.h"
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
-int main() {
+namespace {
+
+    constexpr std::string_view USAGE =
+        "usage: transport_catalogue [--diagnostics] [--save-snapshot=PATH] [--snapshot=PATH] < input.json\n"
+        "  --diagnostics         report catalogue allocations, delta invalidation, skipped phases\n"
+        "                        and map cache statistics to stderr\n"
+        "  --save-snapshot=PATH  write the catalogue to PATH after base_requests and delta_requests\n"
+        "  --snapshot=PATH       load the catalogue from PATH instead of base_requests\n";
+
+    struct Options {
+        bool diagnostics = false;
+        std::optional<std::string> save_snapshot;
+        std::optional<std::string> snapshot;
+    };
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const auto value = [arg](std::string_view prefix) -> std::optional<std::string> {
+                if (arg.substr(0, prefix.size()) == prefix && arg.size() > prefix.size()) {
+                    return std::string(arg.substr(prefix.size()));
+                }
+                return std::nullopt;
+            };
+            if (arg == "--diagnostics") {
+                options.diagnostics = true;
+            } else if (auto path = value("--save-snapshot=")) {
+                options.save_snapshot = std::move(path);
+            } else if (auto path = value("--snapshot=")) {
+                options.snapshot = std::move(path);
+            } else {
+                throw std::invalid_argument("unknown option " + std::string(arg));
+            }
+        }
+        return options;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
     //LOG_DURATION("ALL PROGRAM");
     // std::ifstream file("/home/maksim/CLionProjects/transport_catalogue_by_deepseek/cmake-build-debug/s10_final_opentest_3.json");
     // if (!file) {
@@ -11,17 +56,83 @@ int main() {
     //     return 1;
     // }
 
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n' << USAGE;
+        return 1;
+    }
+
     transport::TransportCatalogue transportCatalogue;
     transport::JsonReader jsonReader;
 
-    jsonReader.Input(std::cin);
+    const transport::AllocationStats before_load = transportCatalogue.GetAllocationStats();
+    jsonReader.InputParallel(std::cin, transportCatalogue);
+
+    // Подготовка выполняется, только если её результат нужен хотя бы одному запросу.
+    // Карта рисуется при ответе на Map, поэтому здесь её настройки не разбираются
+    const transport::StatRequirements requirements = jsonReader.ScanStatRequests();
+
+    try {
+        if (options.snapshot) {
+            const transport::snapshot::MappedCatalogue snapshot(*options.snapshot);
+            // Bus и Stop без изменений каталога отвечаются прямо из отображённых страниц
+            if (!requirements.catalogue && !jsonReader.HasDeltaRequests() && !options.save_snapshot) {
+                jsonReader.StatRequestsProcessing(snapshot);
+                return 0;
+            }
+            transport::snapshot::Restore(snapshot, transportCatalogue);
+        }
+
+        // Производные структуры строятся ниже, уже по изменённому каталогу; кэш карты
+        // сбрасывается в DeltaRequestsProcessing. Здесь остаётся лишь сообщить, что затронуто
+        const auto invalidation = jsonReader.DeltaRequestsProcessing(transportCatalogue);
+        if (options.diagnostics && jsonReader.HasDeltaRequests()) {
+            std::cerr << "delta: router " << (invalidation.router ? "invalidated" : "kept")
+                      << ", map " << (invalidation.map ? "invalidated" : "kept")
+                      << ", name index " << (invalidation.name_index ? "invalidated" : "kept") << '\n';
+        }
+
+        if (options.save_snapshot) {
+            transport::snapshot::Save(transportCatalogue, *options.save_snapshot);
+        }
+    } catch (const transport::snapshot::SnapshotError& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    if (options.diagnostics) {
+        const transport::AllocationStats after_load = transportCatalogue.GetAllocationStats();
+        const memory::Usage retired = transportCatalogue.GetMemoryStats().retired;
+        std::cerr << "catalogue arena: before load " << before_load.allocations << " allocations, "
+                  << before_load.bytes << " bytes; after load " << after_load.allocations << " allocations, "
+                  << after_load.bytes << " bytes, " << after_load.upstream_bytes << " bytes from the system; "
+                  << retired.elements << " retired objects, " << retired.bytes << " bytes\n";
+    }
+
+    if (requirements.name_index) {
+        transportCatalogue.BuildNameIndex();
+    } else if (options.diagnostics) {
+        std::cerr << "skipped: name index (no Search requests)\n";
+    }
+    if (requirements.router) {
+        jsonReader.ParseRoutingSettings(transportCatalogue);
+        transportCatalogue.BuildRouter();
+    } else if (options.diagnostics) {
+        std::cerr << "skipped: routing settings, router (no Route or Stats requests)\n";
+    }
+    if (!requirements.render_settings && options.diagnostics) {
+        std::cerr << "skipped: render settings, map (no Map requests)\n";
+    }
 
-    jsonReader.BaseRequestsProcessing(transportCatalogue);
-    jsonReader.ParseRoutingSettings(transportCatalogue);
-    renderer::RenderSettings render_settings = jsonReader.ParseRenderSettings();
-    renderer::MapRenderer renderer;
-    renderer.SetSettings(render_settings);
-    svg::Document doc = renderer.RenderMap(transportCatalogue);
-    transportCatalogue.BuildRouter();
     jsonReader.StatRequestsProcessing(transportCatalogue);
-}
\ No newline at end of file
+    const auto map_cache = jsonReader.GetMapCacheStats();
+    if (options.diagnostics && map_cache.hits + map_cache.misses > 0) {
+        std::cerr << "map cache: " << map_cache.hits << " hits, " << map_cache.misses << " misses, "
+                  << map_cache.model_builds << " model builds\n";
+        for (const auto& sample : map_cache.renders) {
+            std::cerr << "map render, simplify tolerance " << sample.tolerance << " px: " << sample.bytes << " bytes, "
+                      << sample.renders << " renders, " << sample.milliseconds << " ms\n";
+        }
+    }
+}
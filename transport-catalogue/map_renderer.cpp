@@ -1,10 +1,19 @@
 #include "map_renderer.h"
+#include "json.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 
 namespace renderer {
 
+using namespace std::literals;
+
 inline const double EPSILON = 1e-6;
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
@@ -77,175 +86,1104 @@ private:
     double zoom_coeff_ = 0;
 };
 
+namespace {
+
+void HashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+void HashColor(size_t& seed, const svg::Color& color) {
+    HashCombine(seed, color.index());
+    if (const auto* name = std::get_if<std::string>(&color)) {
+        HashCombine(seed, std::hash<std::string>{}(*name));
+    } else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+        HashCombine(seed, (rgb->red << 16) | (rgb->green << 8) | rgb->blue);
+    } else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+        HashCombine(seed, (rgba->red << 16) | (rgba->green << 8) | rgba->blue);
+        HashCombine(seed, std::hash<double>{}(rgba->opacity));
+    }
+}
+
+} // namespace
+
+size_t HashRenderSettings(const RenderSettings& settings) {
+    const std::hash<double> hash_double;
+    size_t seed = 0;
+    for (const double value : {settings.width_, settings.height_, settings.padding_, settings.line_width_,
+                               settings.stop_radius_, settings.bus_label_offset_.x, settings.bus_label_offset_.y,
+                               settings.stop_label_offset_.x, settings.stop_label_offset_.y,
+                               settings.underlayer_width_}) {
+        HashCombine(seed, hash_double(value));
+    }
+    HashCombine(seed, settings.bus_label_font_size_);
+    HashCombine(seed, settings.stop_label_font_size_);
+    HashColor(seed, settings.underlayer_color_);
+    HashCombine(seed, settings.color_palette_.size());
+    for (const auto& color : settings.color_palette_) {
+        HashColor(seed, color);
+    }
+    HashCombine(seed, settings.coordinate_precision_.has_value());
+    HashCombine(seed, settings.coordinate_precision_.value_or(0));
+    HashCombine(seed, hash_double(settings.simplify_tolerance_.value_or(0)));
+    HashCombine(seed, settings.compact_svg_);
+    return seed;
+}
+
+bool MapCache::Key::Matches(const transport::TransportCatalogue& other_catalogue,
+                            const RenderSettings& other_settings, size_t other_hash) const {
+    return catalogue == &other_catalogue && version == other_catalogue.GetVersion()
+        && settings_hash == other_hash && settings == other_settings;
+}
+
+MapCache::Key MapCache::MakeKey(const transport::TransportCatalogue& catalogue, const RenderSettings& settings,
+                                size_t hash) {
+    return {&catalogue, catalogue.GetVersion(), hash, settings};
+}
+
+std::string_view MapCache::Get(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    const size_t hash = HashRenderSettings(settings);
+    if (svg_key_.Matches(catalogue, settings, hash)) {
+        ++stats_.hits;
+        return svg_;
+    }
+    ++stats_.misses;
+
+    svg_.clear();
+    RenderTo(GetModel(catalogue, settings), settings, svg_);
+    svg_key_ = MakeKey(catalogue, settings, hash);
+    return svg_;
+}
+
+std::string_view MapCache::GetJson(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    const size_t hash = HashRenderSettings(settings);
+    if (json_key_.Matches(catalogue, settings, hash)) {
+        ++stats_.hits;
+        return json_;
+    }
+
+    json_.clear();
+    if (svg_key_.Matches(catalogue, settings, hash)) {
+        ++stats_.hits;
+        json::AppendString(json_, svg_);
+    } else {
+        ++stats_.misses;
+        std::string svg;
+        RenderTo(GetModel(catalogue, settings), settings, svg);
+        json::AppendString(json_, svg);
+    }
+    json_key_ = MakeKey(catalogue, settings, hash);
+    return json_;
+}
+
+std::string MapCache::Render(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    ++stats_.misses;
+    std::string svg;
+    RenderTo(GetModel(catalogue, settings), settings, svg);
+    return svg;
+}
+
+const RenderModel& MapCache::GetModel(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    if (!model_ || !(model_->GetSource() == RenderModel::MakeSource(catalogue, settings))) {
+        model_.emplace(catalogue, settings);
+        ++stats_.model_builds;
+    }
+    return *model_;
+}
+
+void MapCache::RenderTo(const RenderModel& model, const RenderSettings& settings, std::string& out) {
+    const auto start = std::chrono::steady_clock::now();
+    MapRenderer map_renderer;
+    map_renderer.SetSettings(settings);
+    map_renderer.SetRouteLod(&route_lod_);
+    map_renderer.SetThreads(threads_);
+    map_renderer.RenderMap(model, out);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double tolerance = std::max(settings.simplify_tolerance_.value_or(0), 0.0);
+    auto sample = std::find_if(stats_.renders.begin(), stats_.renders.end(), [tolerance](const RenderSample& item) {
+        return item.tolerance == tolerance;
+    });
+    if (sample == stats_.renders.end()) {
+        sample = stats_.renders.insert(sample, RenderSample{tolerance});
+    }
+    ++sample->renders;
+    sample->bytes = out.size();
+    sample->milliseconds += elapsed.count();
+}
+
+const MapIndex& MapCache::GetIndex(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    const size_t hash = HashRenderSettings(settings);
+    if (index_ && index_key_.Matches(catalogue, settings, hash)) {
+        ++stats_.hits;
+        return *index_;
+    }
+    ++stats_.misses;
+    index_.emplace(GetModel(catalogue, settings), settings);
+    index_key_ = MakeKey(catalogue, settings, hash);
+    return *index_;
+}
+
+void MapCache::Clear() {
+    svg_key_ = {};
+    svg_ = std::string();
+    json_key_ = {};
+    json_ = std::string();
+    index_key_ = {};
+    index_.reset();
+    model_.reset();
+    route_lod_.Clear();
+}
+
+MapCache::Stats MapCache::GetStats() const {
+    return stats_;
+}
+
+MapCache::MemoryStats MapCache::GetMemoryStats() const {
+    MemoryStats stats;
+    if (model_) {
+        stats.model = model_->GetMemoryUsage();
+    }
+    stats.svg = memory::ForString(svg_);
+    stats.json = memory::ForString(json_);
+    if (index_) {
+        stats.index = index_->GetMemoryUsage();
+    }
+    stats.route_lod = route_lod_.GetMemoryUsage();
+    return stats;
+}
+
+void MapCache::SetThreads(size_t threads) {
+    threads_ = threads;
+}
+
 void MapRenderer::SetSettings(const RenderSettings& settings) {
     settings_ = settings;
 }
 
+void MapRenderer::SetRouteLod(RouteLod* route_lod) {
+    route_lod_ = route_lod;
+}
+
+void MapRenderer::SetThreads(size_t threads) {
+    threads_ = threads;
+}
+
+svg::NumberFormat MapRenderer::GetNumberFormat() const {
+    return {settings_.coordinate_precision_};
+}
+
 svg::Document renderer::MapRenderer::RenderMap(const transport::TransportCatalogue &catalogue) const {
     svg::Document doc;
-    std::set<std::string_view> sorted_bus_names = catalogue.GetBusNames();
-    std::vector<geo::Coordinates> all_coords;
-    for (const auto& name : sorted_bus_names) {
-        const auto* bus = catalogue.FindBus(name);
-        if (!bus || bus->stops.empty()) {
-            continue;
+    RenderMap(catalogue, doc);
+    return doc;
+}
+
+svg::ValueDocument MapRenderer::RenderValueDocument(const transport::TransportCatalogue& catalogue) const {
+    const RenderModel model(catalogue, settings_);
+    // Фигур не больше, чем ломаных по автобусам, кругов по остановкам и пар надписей на подпись
+    size_t bus_labels = 0;
+    for (const auto& bus : model.GetBuses()) {
+        bus_labels += bus.end ? 2 : 1;
+    }
+    svg::ValueDocument doc;
+    doc.Reserve(model.GetStops().size(), model.GetBuses().size(), 2 * (bus_labels + model.GetStops().size()));
+    RenderMap(model, doc);
+    return doc;
+}
+
+void MapRenderer::RenderMap(const transport::TransportCatalogue &catalogue, svg::ObjectContainer &doc) const {
+    RenderMap(RenderModel(catalogue, settings_), doc);
+}
+
+void MapRenderer::RenderMap(const RenderModel& model, svg::ObjectContainer& doc) const {
+    RouteLod local_lod;
+    RenderBusesRoute(model, GetLodLevel(model, local_lod), doc);
+    RenderBusesNames(model, doc);
+    RenderStopsCircles(model, doc);
+    RenderStopsNames(model, doc);
+}
+
+const RouteLod::Level* MapRenderer::GetLodLevel(const RenderModel& model, RouteLod& local) const {
+    const double tolerance = settings_.simplify_tolerance_.value_or(0);
+    if (!(tolerance > 0)) {
+        return nullptr;
+    }
+    return &(route_lod_ ? *route_lod_ : local).Get(model, tolerance);
+}
+
+namespace {
+
+double SquaredDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length = dx * dx + dy * dy;
+    double t = 0;
+    if (length > 0) {
+        t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0.0, 1.0);
+    }
+    const double x = from.x + t * dx - point.x;
+    const double y = from.y + t * dy - point.y;
+    return x * x + y * y;
+}
+
+// Уровней упрощения в RouteLod; при переполнении отбрасывается самый мелкий допуск
+constexpr size_t MAX_LOD_LEVELS = 8;
+
+const svg::Color ROUTE_FILL{"none"};
+const svg::Color STOP_CIRCLE_FILL{"white"};
+const svg::Color STOP_LABEL_FILL{"black"};
+
+// Без палитры маршруты и подписи автобусов выводятся без цвета
+const svg::Color NO_COLOR{};
+
+svg::StreamWriter::PathAttrs FillOnly(const svg::Color& color) {
+    svg::StreamWriter::PathAttrs attrs;
+    attrs.fill = &color;
+    return attrs;
+}
+
+const svg::Color& BusColor(const RenderSettings& settings, size_t bus_index) {
+    const auto& palette = settings.color_palette_;
+    return palette.empty() ? NO_COLOR : palette[bus_index % palette.size()];
+}
+
+// Вершины ломаной автобуса: из уровня упрощения или полные из модели
+std::span<const svg::Point> BusPoints(const RenderModel& model, const RouteLod::Level* lod, size_t bus_index) {
+    if (lod) {
+        return std::span<const svg::Point>(lod->points)
+            .subspan(lod->offsets[bus_index], lod->offsets[bus_index + 1] - lod->offsets[bus_index]);
+    }
+    return model.GetRoute(model.GetBuses()[bus_index]);
+}
+
+} // namespace
+
+RenderModel::RenderModel(const transport::TransportCatalogue& catalogue, const RenderSettings& settings)
+    : source_(MakeSource(catalogue, settings)) {
+    const auto by_name = [](const auto* lhs, const auto* rhs) {
+        return lhs->name < rhs->name;
+    };
+
+    std::vector<const transport::Bus*> buses;
+    for (const auto& bus : catalogue.GetBuses()) {
+        if (!bus.stops.empty() && !bus.name.empty() && catalogue.FindBus(bus.name) == &bus) {
+            buses.push_back(&bus);
         }
+    }
+    std::sort(buses.begin(), buses.end(), by_name);
+
+    std::vector<const transport::Stop*> stops;
+    std::vector<geo::Coordinates> all_coords;
+    for (const auto* bus : buses) {
         for (const auto* stop : bus->stops) {
+            stops.push_back(stop);
             all_coords.push_back(stop->coordinates);
         }
     }
+    std::sort(stops.begin(), stops.end(), by_name);
+    stops.erase(std::unique(stops.begin(), stops.end(), [](const auto* lhs, const auto* rhs) {
+        return lhs->name == rhs->name;
+    }), stops.end());
 
-    SphereProjector projector(
+    const SphereProjector projector(
         all_coords.begin(), all_coords.end(),
-        settings_.width_, settings_.height_, settings_.padding_
+        settings.width_, settings.height_, settings.padding_
     );
-    RenderBusesRoute(catalogue, doc, sorted_bus_names, projector);
-    RenderBusesNames(catalogue, doc, sorted_bus_names, projector);
-    RenderStopsCircles(catalogue, doc, sorted_bus_names, projector);
-    RenderStopsNames(catalogue, doc, sorted_bus_names, projector);
-    return doc;
+
+    // Обратный путь некольцевого маршрута повторяет уже спроецированные точки
+    buses_.reserve(buses.size());
+    points_.reserve(all_coords.size() * 2);
+    for (const auto* bus : buses) {
+        const auto first_point = static_cast<uint32_t>(points_.size());
+        const size_t stop_count = bus->stops.size();
+        for (const auto* stop : bus->stops) {
+            points_.push_back(projector(stop->coordinates));
+        }
+        if (!bus->is_roundtrip) {
+            for (size_t i = stop_count - 1; i-- > 0;) {
+                points_.push_back(points_[first_point + i]);
+            }
+        }
+
+        BusRoute& route = buses_.emplace_back();
+        route.name = bus->name;
+        route.first_point = first_point;
+        route.point_count = static_cast<uint32_t>(points_.size()) - first_point;
+        route.start = points_[first_point];
+        if (!bus->is_roundtrip && bus->stops.front() != bus->stops.back()) {
+            route.end = points_[first_point + stop_count - 1];
+        }
+    }
+
+    stops_.reserve(stops.size());
+    for (const auto* stop : stops) {
+        stops_.push_back({stop->name, projector(stop->coordinates)});
+    }
 }
 
-void MapRenderer::RenderBusesRoute(const transport::TransportCatalogue &catalogue
-                                    , svg::Document &doc
-                                    , const std::set<std::string_view> &sorted_bus_names
-                                    , const SphereProjector& projector) const {
-    size_t bus_index = 0;
-    size_t color_index = 0;
-    for (const auto& name : sorted_bus_names) {
-        const auto* bus = catalogue.FindBus(name);
-        if (!bus || bus->stops.empty()) {
-            continue;
+RenderModel::Source RenderModel::MakeSource(const transport::TransportCatalogue& catalogue, const RenderSettings& settings) {
+    return {&catalogue, catalogue.GetVersion(), settings.width_, settings.height_, settings.padding_};
+}
+
+const RenderModel::Source& RenderModel::GetSource() const {
+    return source_;
+}
+
+std::span<const RenderModel::BusRoute> RenderModel::GetBuses() const {
+    return buses_;
+}
+
+std::span<const svg::Point> RenderModel::GetRoute(const BusRoute& bus) const {
+    return std::span<const svg::Point>(points_).subspan(bus.first_point, bus.point_count);
+}
+
+std::span<const svg::Point> RenderModel::GetPoints() const {
+    return points_;
+}
+
+std::span<const RenderModel::StopMark> RenderModel::GetStops() const {
+    return stops_;
+}
+
+memory::Usage RenderModel::GetMemoryUsage() const {
+    memory::Usage usage = memory::ForVector(buses_);
+    usage += memory::ForVector(points_);
+    usage += memory::ForVector(stops_);
+    return usage;
+}
+
+void SimplifyPolyline(std::span<const svg::Point> points, double tolerance, std::vector<svg::Point>& out) {
+    if (points.size() < 3 || !(tolerance > 0)) {
+        out.insert(out.end(), points.begin(), points.end());
+        return;
+    }
+
+    // Отрезки обрабатываются стеком, а не рекурсией: у длинных маршрутов она слишком глубока
+    std::vector<bool> keep(points.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+    std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+    const double limit = tolerance * tolerance;
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        double max_distance = 0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+        if (max_distance > limit) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
         }
+    }
 
-        svg::Polyline polyline;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) {
+            out.push_back(points[i]);
+        }
+    }
+}
 
-        for (const auto* stop : bus->stops) {
-            polyline.AddPoint(projector(stop->coordinates));
+const RouteLod::Level& RouteLod::Get(const RenderModel& model, double tolerance) {
+    if (!(source_ == model.GetSource())) {
+        levels_.clear();
+        source_ = model.GetSource();
+    }
+    if (const auto it = levels_.find(tolerance); it != levels_.end()) {
+        return it->second;
+    }
+    if (levels_.size() == MAX_LOD_LEVELS) {
+        levels_.erase(levels_.begin());
+    }
+
+    Level& level = levels_[tolerance];
+    for (const auto& bus : model.GetBuses()) {
+        SimplifyPolyline(model.GetRoute(bus), tolerance, level.points);
+        level.offsets.push_back(static_cast<uint32_t>(level.points.size()));
+    }
+    return level;
+}
+
+void RouteLod::Clear() {
+    source_ = {};
+    levels_.clear();
+}
+
+memory::Usage RouteLod::GetMemoryUsage() const {
+    memory::Usage usage{memory::ForTree(levels_).bytes, 0};
+    for (const auto& [tolerance, level] : levels_) {
+        usage += memory::ForVector(level.points);
+        usage.bytes += memory::ForVector(level.offsets).bytes;
+    }
+    return usage;
+}
+
+/*
+ * Вывод элементов карты в строку. В компактном режиме оформление собрано в CSS-классы
+ * блока <style>, подложка подписи рисуется тем же <text> через paint-order, смещение
+ * подписи прибавлено к её координатам, а круги остановок ссылаются через <use> на один
+ * круг из <defs>. paint-order и <use href> есть только в SVG 2, поэтому компактный документ
+ * не объявляет version="1.1". На экране компактная карта не отличается от полной
+ */
+class MapWriter {
+public:
+    MapWriter(const RenderSettings& settings, std::string& out)
+        : settings_(settings)
+        , writer_(out, {settings.coordinate_precision_})
+        , underlayer_{.fill = &settings.underlayer_color_,
+                      .stroke = &settings.underlayer_color_,
+                      .stroke_width = settings.underlayer_width_,
+                      .stroke_line_cap = svg::StrokeLineCap::ROUND,
+                      .stroke_line_join = svg::StrokeLineJoin::ROUND} {
+    }
+
+    // Заголовок документа и, в компактном режиме, стили для bus_count автобусов
+    void BeginDocument(size_t bus_count) {
+        writer_.BeginDocument(settings_.compact_svg_);
+        WriteDefinitions(bus_count);
+    }
+
+    void BeginDocument(const Viewport& viewport, size_t bus_count) {
+        writer_.BeginDocument({viewport.min_x, viewport.min_y,
+                               viewport.max_x - viewport.min_x, viewport.max_y - viewport.min_y},
+                              settings_.compact_svg_);
+        WriteDefinitions(bus_count);
+    }
+
+    void EndDocument() {
+        writer_.EndDocument();
+    }
+
+    void BeginRoute() {
+        writer_.BeginPolyline();
+    }
+
+    void AddRoutePoint(svg::Point point) {
+        writer_.AddPolylinePoint(point);
+    }
+
+    void EndRoute(size_t bus_index) {
+        if (settings_.compact_svg_) {
+            writer_.EndPolyline(ClassNames("r s"sv, bus_index));
+            return;
         }
+        writer_.EndPolyline({.fill = &ROUTE_FILL,
+                             .stroke = &BusColor(settings_, bus_index),
+                             .stroke_width = settings_.line_width_,
+                             .stroke_line_cap = svg::StrokeLineCap::ROUND,
+                             .stroke_line_join = svg::StrokeLineJoin::ROUND});
+    }
 
-        if (!bus->is_roundtrip) {
-            for (auto it = bus->stops.rbegin() + 1; it != bus->stops.rend(); ++it) {
-                polyline.AddPoint(projector((*it)->coordinates));
+    void WriteBusLabel(size_t bus_index, std::string_view name, svg::Point position) {
+        if (settings_.compact_svg_) {
+            writer_.WriteText(ClassNames("u b f"sv, bus_index), Shift(position, settings_.bus_label_offset_), name);
+            return;
+        }
+        const svg::StreamWriter::TextAttrs text{position, settings_.bus_label_offset_,
+                                                static_cast<uint32_t>(settings_.bus_label_font_size_), "Verdana", "bold"};
+        writer_.WriteText(underlayer_, text, name);
+        writer_.WriteText(FillOnly(BusColor(settings_, bus_index)), text, name);
+    }
+
+    void WriteStopCircle(svg::Point center) {
+        if (settings_.compact_svg_) {
+            writer_.WriteUse(STOP_CIRCLE_ID, center);
+            return;
+        }
+        writer_.WriteCircle(center, settings_.stop_radius_, FillOnly(STOP_CIRCLE_FILL));
+    }
+
+    void WriteStopLabel(std::string_view name, svg::Point position) {
+        if (settings_.compact_svg_) {
+            writer_.WriteText("u t"sv, Shift(position, settings_.stop_label_offset_), name);
+            return;
+        }
+        const svg::StreamWriter::TextAttrs text{position, settings_.stop_label_offset_,
+                                                static_cast<uint32_t>(settings_.stop_label_font_size_), "Verdana", {}};
+        writer_.WriteText(underlayer_, text, name);
+        writer_.WriteText(FillOnly(STOP_LABEL_FILL), text, name);
+    }
+
+private:
+    static constexpr std::string_view STOP_CIRCLE_ID = "p"sv;
+
+    static svg::Point Shift(svg::Point position, svg::Point offset) {
+        return {position.x + offset.x, position.y + offset.y};
+    }
+
+    // Класс цвета автобуса: номер цвета в палитре; без палитры - единственный класс бесцветного
+    size_t ColorClass(size_t bus_index) const {
+        const size_t palette_size = settings_.color_palette_.size();
+        return palette_size == 0 ? 0 : bus_index % palette_size;
+    }
+
+    std::string_view ClassNames(std::string_view prefix, size_t bus_index) {
+        class_names_.assign(prefix);
+        class_names_ += std::to_string(ColorClass(bus_index));
+        return class_names_;
+    }
+
+    void WriteDefinitions(size_t bus_count) {
+        if (!settings_.compact_svg_) {
+            return;
+        }
+        std::string css = ".r{fill:none;stroke-width:";
+        svg::detail::AppendNumber(css, settings_.line_width_);
+        css += ";stroke-linecap:round;stroke-linejoin:round}.u{stroke:"sv;
+        svg::AppendColor(css, settings_.underlayer_color_);
+        css += ";stroke-width:"sv;
+        svg::detail::AppendNumber(css, settings_.underlayer_width_);
+        css += ";stroke-linecap:round;stroke-linejoin:round;paint-order:stroke}.b{font-family:Verdana;font-size:"sv;
+        css += std::to_string(static_cast<uint32_t>(settings_.bus_label_font_size_));
+        css += "px;font-weight:bold}.t{font-family:Verdana;font-size:"sv;
+        css += std::to_string(static_cast<uint32_t>(settings_.stop_label_font_size_));
+        css += "px;fill:black}"sv;
+        const size_t color_classes = std::min(bus_count, std::max<size_t>(settings_.color_palette_.size(), 1));
+        for (size_t i = 0; i < color_classes; ++i) {
+            const svg::Color& color = BusColor(settings_, i);
+            const std::string index = std::to_string(i);
+            css += ".s"sv;
+            css += index;
+            css += "{stroke:"sv;
+            svg::AppendColor(css, color);
+            css += "}.f"sv;
+            css += index;
+            css += "{fill:"sv;
+            svg::AppendColor(css, color);
+            css += '}';
+        }
+        writer_.WriteStyle(css);
+        writer_.WriteCircleDef(STOP_CIRCLE_ID, settings_.stop_radius_, FillOnly(STOP_CIRCLE_FILL));
+    }
+
+    const RenderSettings& settings_;
+    svg::StreamWriter writer_;
+    svg::StreamWriter::PathAttrs underlayer_;
+    std::string class_names_;
+};
+
+namespace {
+
+// Вес части слоя при параллельной отрисовке: вершины ломаных и элементы SVG
+constexpr size_t MAP_PIECE_WEIGHT = 4096;
+// Меньшие карты рисуются в одном потоке: запуск потоков дороже самой отрисовки
+constexpr size_t PARALLEL_MAP_MIN_WEIGHT = 4 * MAP_PIECE_WEIGHT;
+
+enum class MapLayer : uint8_t {
+    ROUTES,
+    BUS_LABELS,
+    STOP_CIRCLES,
+    STOP_LABELS
+};
+
+// Часть слоя: автобусы или остановки [first, last)
+struct MapPiece {
+    MapLayer layer = MapLayer::ROUTES;
+    size_t first = 0;
+    size_t last = 0;
+};
+
+// Слои карты при выводе в строку; части слоёв можно выводить независимо
+class StreamLayers {
+public:
+    StreamLayers(const RenderModel& model, const RouteLod::Level* lod)
+        : model_(model)
+        , lod_(lod) {
+    }
+
+    size_t GetSize(MapLayer layer) const {
+        return layer == MapLayer::ROUTES || layer == MapLayer::BUS_LABELS ? model_.GetBuses().size()
+                                                                          : model_.GetStops().size();
+    }
+
+    size_t GetWeight(MapLayer layer, size_t index) const {
+        switch (layer) {
+        case MapLayer::ROUTES:
+            return 1 + BusPoints(model_, lod_, index).size();
+        case MapLayer::BUS_LABELS:
+            return 4;
+        case MapLayer::STOP_CIRCLES:
+            return 1;
+        case MapLayer::STOP_LABELS:
+            return 2;
+        }
+        return 1;
+    }
+
+    void Write(MapWriter& writer, const MapPiece& piece) const {
+        const auto buses = model_.GetBuses();
+        const auto stops = model_.GetStops();
+        for (size_t i = piece.first; i < piece.last; ++i) {
+            switch (piece.layer) {
+            case MapLayer::ROUTES:
+                writer.BeginRoute();
+                for (const svg::Point point : BusPoints(model_, lod_, i)) {
+                    writer.AddRoutePoint(point);
+                }
+                writer.EndRoute(i);
+                break;
+            case MapLayer::BUS_LABELS:
+                writer.WriteBusLabel(i, buses[i].name, buses[i].start);
+                if (buses[i].end) {
+                    writer.WriteBusLabel(i, buses[i].name, *buses[i].end);
+                }
+                break;
+            case MapLayer::STOP_CIRCLES:
+                writer.WriteStopCircle(stops[i].position);
+                break;
+            case MapLayer::STOP_LABELS:
+                writer.WriteStopLabel(stops[i].name, stops[i].position);
+                break;
             }
         }
+    }
+
+private:
+    const RenderModel& model_;
+    const RouteLod::Level* lod_;
+};
 
+constexpr MapLayer MAP_LAYERS[] = {MapLayer::ROUTES, MapLayer::BUS_LABELS, MapLayer::STOP_CIRCLES, MapLayer::STOP_LABELS};
 
-        if (color_index == settings_.color_palette_.size()) {
-            color_index = 0;
+// Делит слои на части весом около MAP_PIECE_WEIGHT; возвращает части и общий вес
+std::pair<std::vector<MapPiece>, size_t> SplitLayers(const StreamLayers& layers) {
+    std::vector<MapPiece> pieces;
+    size_t total = 0;
+    for (const MapLayer layer : MAP_LAYERS) {
+        const size_t size = layers.GetSize(layer);
+        size_t first = 0;
+        size_t weight = 0;
+        for (size_t i = 0; i < size; ++i) {
+            weight += layers.GetWeight(layer, i);
+            if (weight >= MAP_PIECE_WEIGHT) {
+                pieces.push_back({layer, first, i + 1});
+                total += weight;
+                first = i + 1;
+                weight = 0;
+            }
         }
-        const svg::Color color = settings_.color_palette_[color_index];
-        polyline.SetFillColor("none")
-               .SetStrokeColor(color)
-               .SetStrokeWidth(settings_.line_width_)
-               .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-               .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        if (first < size) {
+            pieces.push_back({layer, first, size});
+            total += weight;
+        }
+    }
+    return {std::move(pieces), total};
+}
 
-        doc.Add(polyline);
-        bus_index++;
-        color_index++;
+} // namespace
+
+void MapRenderer::RenderMap(const transport::TransportCatalogue& catalogue, std::string& out) const {
+    RenderMap(RenderModel(catalogue, settings_), out);
+}
+
+// Слои и порядок элементов те же, что у RenderMap с документом.
+// Большая карта рисуется частями в нескольких потоках и склеивается в исходном порядке
+void MapRenderer::RenderMap(const RenderModel& model, std::string& out) const {
+    RouteLod local_lod;
+    const StreamLayers layers(model, GetLodLevel(model, local_lod));
+    const auto [pieces, weight] = SplitLayers(layers);
+    const size_t threads = std::min(threads_ == 0 ? std::thread::hardware_concurrency() : threads_, pieces.size());
+
+    MapWriter writer(settings_, out);
+    writer.BeginDocument(model.GetBuses().size());
+    if (threads < 2 || weight < PARALLEL_MAP_MIN_WEIGHT) {
+        for (const MapPiece& piece : pieces) {
+            layers.Write(writer, piece);
+        }
+    } else {
+        std::vector<std::string> parts(pieces.size());
+        std::atomic<size_t> next_piece = 0;
+        const auto work = [&] {
+            for (size_t i = next_piece++; i < pieces.size(); i = next_piece++) {
+                MapWriter part_writer(settings_, parts[i]);
+                layers.Write(part_writer, pieces[i]);
+            }
+        };
+        {
+            std::vector<std::jthread> pool;
+            for (size_t i = 1; i < threads; ++i) {
+                pool.emplace_back(work);
+            }
+            work();
+        }
+        size_t size = out.size();
+        for (const auto& part : parts) {
+            size += part.size();
+        }
+        out.reserve(size + 16);
+        for (const auto& part : parts) {
+            out += part;
+        }
     }
+    writer.EndDocument();
 }
 
-void MapRenderer::RenderBusesNames(const transport::TransportCatalogue &catalogue
-                                    , svg::Document &doc
-                                    , const std::set<std::string_view> &sorted_bus_names
-                                    , const SphereProjector& projector) const {
-    size_t bus_index = 0;
-    size_t color_index = 0;
-    for (const auto& name : sorted_bus_names) {
-        const auto* bus = catalogue.FindBus(name);
-        if (!bus || bus->stops.empty()) {
-            continue;
+Viewport TileViewport(const RenderSettings& settings, Tile tile) {
+    if (tile.z < 0 || tile.z > 30) {
+        throw std::out_of_range("Tile zoom must be in 0..30");
+    }
+    const int count = 1 << tile.z;
+    if (tile.x < 0 || tile.x >= count || tile.y < 0 || tile.y >= count) {
+        throw std::out_of_range("Tile is outside of its zoom level");
+    }
+    const double width = settings.width_ / count;
+    const double height = settings.height_ / count;
+    return {tile.x * width, tile.y * height, (tile.x + 1) * width, (tile.y + 1) * height};
+}
+
+namespace {
+
+// Элементов на ячейку сетки в среднем
+constexpr size_t GRID_CELL_LOAD = 4;
+constexpr size_t GRID_MAX_SIDE = 1024;
+
+Viewport Shifted(const Viewport& area, svg::Point offset) {
+    return {area.min_x + offset.x, area.min_y + offset.y, area.max_x + offset.x, area.max_y + offset.y};
+}
+
+Viewport Expanded(const Viewport& area, double margin) {
+    return {area.min_x - margin, area.min_y - margin, area.max_x + margin, area.max_y + margin};
+}
+
+bool Contains(const Viewport& area, svg::Point point) {
+    return point.x >= area.min_x && point.x <= area.max_x && point.y >= area.min_y && point.y <= area.max_y;
+}
+
+bool Touches(const Viewport& area, svg::Point center, double radius) {
+    const double dx = std::max({area.min_x - center.x, 0.0, center.x - area.max_x});
+    const double dy = std::max({area.min_y - center.y, 0.0, center.y - area.max_y});
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+struct ClippedSegment {
+    svg::Point from;
+    svg::Point to;
+    bool from_clipped = false;
+    bool to_clipped = false;
+};
+
+// Отсечение отрезка по прямоугольнику (Лианг - Барски); пусто, если отрезок целиком снаружи
+std::optional<ClippedSegment> ClipSegment(const Viewport& area, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    double t0 = 0;
+    double t1 = 1;
+    const auto clip = [&t0, &t1](double p, double q) {
+        if (p == 0) {
+            return q >= 0;
+        }
+        const double t = q / p;
+        if (p < 0) {
+            if (t > t1) {
+                return false;
+            }
+            t0 = std::max(t0, t);
+        } else {
+            if (t < t0) {
+                return false;
+            }
+            t1 = std::min(t1, t);
         }
+        return true;
+    };
+    if (!clip(-dx, from.x - area.min_x) || !clip(dx, area.max_x - from.x)
+        || !clip(-dy, from.y - area.min_y) || !clip(dy, area.max_y - from.y)) {
+        return std::nullopt;
+    }
 
-        if (color_index == settings_.color_palette_.size()) {
-            color_index = 0;
+    ClippedSegment result{from, to, t0 > 0, t1 < 1};
+    if (result.from_clipped) {
+        result.from = {from.x + t0 * dx, from.y + t0 * dy};
+    }
+    if (result.to_clipped) {
+        result.to = {from.x + t1 * dx, from.y + t1 * dy};
+    }
+    return result;
+}
+
+struct CellRange {
+    uint32_t first_column = 0;
+    uint32_t last_column = 0;
+    uint32_t first_row = 0;
+    uint32_t last_row = 0;
+};
+
+uint32_t CellOf(double value, double cell_size, uint32_t count) {
+    const double cell = std::floor(value / cell_size);
+    if (!(cell > 0)) {
+        return 0;
+    }
+    return cell >= count ? count - 1 : static_cast<uint32_t>(cell);
+}
+
+// Точки за краем холста попадают в крайние ячейки
+template <typename Grid>
+CellRange CellsOf(const Grid& grid, const Viewport& area) {
+    return {CellOf(area.min_x, grid.cell_width, grid.columns), CellOf(area.max_x, grid.cell_width, grid.columns),
+            CellOf(area.min_y, grid.cell_height, grid.rows), CellOf(area.max_y, grid.cell_height, grid.rows)};
+}
+
+} // namespace
+
+MapIndex::MapIndex(const RenderModel& model, const RenderSettings& settings)
+    : settings_(settings)
+    , points_(model.GetPoints().begin(), model.GetPoints().end())
+    , buses_(model.GetBuses().begin(), model.GetBuses().end())
+    , stops_(model.GetStops().begin(), model.GetStops().end()) {
+    for (uint32_t bus_index = 0; bus_index < buses_.size(); ++bus_index) {
+        labels_.push_back({buses_[bus_index].start, bus_index});
+        if (buses_[bus_index].end) {
+            labels_.push_back({*buses_[bus_index].end, bus_index});
+        }
+    }
+
+    // Отрезок маршрута нумеруется его первой точкой; маршрут из одной точки даёт отрезок нулевой длины
+    segments_ = BuildGrid(points_.size(), [this](uint32_t id) -> std::optional<Viewport> {
+        const auto& bus = buses_[FindBusOfPoint(id)];
+        if (id + 1 == bus.first_point + bus.point_count && bus.point_count > 1) {
+            return std::nullopt;
         }
-        const svg::Color color = settings_.color_palette_[color_index];
+        const svg::Point from = points_[id];
+        const svg::Point to = bus.point_count > 1 ? points_[id + 1] : from;
+        return Viewport{std::min(from.x, to.x), std::min(from.y, to.y), std::max(from.x, to.x), std::max(from.y, to.y)};
+    });
+    labels_grid_ = BuildGrid(labels_.size(), [this](uint32_t id) -> std::optional<Viewport> {
+        const svg::Point position = labels_[id].position;
+        return Viewport{position.x, position.y, position.x, position.y};
+    });
+    stops_grid_ = BuildGrid(stops_.size(), [this](uint32_t id) -> std::optional<Viewport> {
+        const svg::Point position = stops_[id].position;
+        return Viewport{position.x, position.y, position.x, position.y};
+    });
+}
+
+memory::Usage MapIndex::GetMemoryUsage() const {
+    memory::Usage usage = memory::ForVector(points_);
+    usage += memory::ForVector(buses_);
+    usage += memory::ForVector(labels_);
+    usage += memory::ForVector(stops_);
+    for (const Grid* grid : {&segments_, &labels_grid_, &stops_grid_}) {
+        usage.bytes += memory::ForVector(grid->offsets).bytes + memory::ForVector(grid->ids).bytes;
+    }
+    return usage;
+}
 
-        svg::Text bus_title_start = svg::Text()
-            .SetFontFamily("Verdana")
-            .SetFontSize(settings_.bus_label_font_size_)
-            .SetPosition(projector({bus->stops.front()->coordinates.lat, bus->stops.front()->coordinates.lng}))
-            .SetOffset({settings_.bus_label_offset_.x, settings_.bus_label_offset_.y})
-            .SetData(bus->name)
-            .SetFontWeight("bold");
-        doc.Add(svg::Text{bus_title_start}
-            .SetStrokeColor(settings_.underlayer_color_)
-            .SetFillColor(settings_.underlayer_color_)
-            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-            .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-            .SetStrokeWidth(settings_.underlayer_width_)
-            .SetFontWeight("bold"));
-        doc.Add(svg::Text{bus_title_start}.SetFillColor(color));
+uint32_t MapIndex::FindBusOfPoint(uint32_t point) const {
+    const auto it = std::upper_bound(buses_.begin(), buses_.end(), point,
+                                     [](uint32_t value, const RenderModel::BusRoute& bus) {
+        return value < bus.first_point;
+    });
+    return static_cast<uint32_t>(std::prev(it) - buses_.begin());
+}
 
-        if (!bus->is_roundtrip) {
-            if (bus->stops.front() == bus->stops.back()) {
-                bus_index++;
-                color_index++;
-                continue;
+template <typename Bounds>
+MapIndex::Grid MapIndex::BuildGrid(size_t count, Bounds bounds) const {
+    Grid grid;
+    const auto side = static_cast<uint32_t>(std::clamp<size_t>(
+        static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count) / GRID_CELL_LOAD))), 1, GRID_MAX_SIDE));
+    grid.columns = side;
+    grid.rows = side;
+    if (settings_.width_ > 0) {
+        grid.cell_width = settings_.width_ / side;
+    }
+    if (settings_.height_ > 0) {
+        grid.cell_height = settings_.height_ / side;
+    }
+
+    // Два прохода: сначала размеры ячеек, затем раскладка номеров
+    grid.offsets.assign(static_cast<size_t>(side) * side + 1, 0);
+    const auto for_each_cell = [&grid](const Viewport& area, auto action) {
+        const CellRange cells = CellsOf(grid, area);
+        for (uint32_t row = cells.first_row; row <= cells.last_row; ++row) {
+            for (uint32_t column = cells.first_column; column <= cells.last_column; ++column) {
+                action(static_cast<size_t>(row) * grid.columns + column);
             }
-            svg::Text bus_title_end = svg::Text()
-            .SetFontFamily("Verdana")
-            .SetFontSize(settings_.bus_label_font_size_)
-            .SetPosition(projector({bus->stops.back()->coordinates.lat, bus->stops.back()->coordinates.lng}))
-            .SetOffset({settings_.bus_label_offset_.x, settings_.bus_label_offset_.y})
-            .SetData(bus->name)
-            .SetFontWeight("bold");
-            doc.Add(svg::Text{bus_title_end}
+        }
+    };
+    for (uint32_t id = 0; id < count; ++id) {
+        if (const auto area = bounds(id)) {
+            for_each_cell(*area, [&grid](size_t cell) {
+                ++grid.offsets[cell + 1];
+            });
+        }
+    }
+    std::partial_sum(grid.offsets.begin(), grid.offsets.end(), grid.offsets.begin());
+
+    grid.ids.resize(grid.offsets.back());
+    std::vector<uint32_t> next(grid.offsets.begin(), grid.offsets.end() - 1);
+    for (uint32_t id = 0; id < count; ++id) {
+        if (const auto area = bounds(id)) {
+            for_each_cell(*area, [&grid, &next, id](size_t cell) {
+                grid.ids[next[cell]++] = id;
+            });
+        }
+    }
+    return grid;
+}
+
+void MapIndex::Query(const Grid& grid, const Viewport& area, std::vector<uint32_t>& ids) const {
+    ids.clear();
+    if (area.max_x < area.min_x || area.max_y < area.min_y) {
+        return;
+    }
+    const CellRange cells = CellsOf(grid, area);
+    for (uint32_t row = cells.first_row; row <= cells.last_row; ++row) {
+        const size_t first_cell = static_cast<size_t>(row) * grid.columns;
+        ids.insert(ids.end(), grid.ids.begin() + grid.offsets[first_cell + cells.first_column],
+                   grid.ids.begin() + grid.offsets[first_cell + cells.last_column + 1]);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+// Соседние видимые отрезки одного маршрута, не обрезанные на стыке, идут в одну ломаную
+void MapIndex::RenderRoutes(const Viewport& viewport, MapWriter& writer, std::vector<uint32_t>& ids) const {
+    Query(segments_, viewport, ids);
+
+    std::optional<uint32_t> open_bus;
+    uint32_t last_id = 0;
+    bool last_clipped = false;
+    const auto close = [&writer, &open_bus] {
+        if (open_bus) {
+            writer.EndRoute(*open_bus);
+            open_bus.reset();
+        }
+    };
+
+    for (const uint32_t id : ids) {
+        const uint32_t bus_index = FindBusOfPoint(id);
+        const auto& bus = buses_[bus_index];
+        const svg::Point from = points_[id];
+        const svg::Point to = bus.point_count > 1 ? points_[id + 1] : from;
+        const auto segment = ClipSegment(viewport, from, to);
+        if (!segment) {
+            continue;
+        }
+        if (open_bus != bus_index || last_id + 1 != id || last_clipped || segment->from_clipped) {
+            close();
+            writer.BeginRoute();
+            writer.AddRoutePoint(segment->from);
+            open_bus = bus_index;
+        }
+        if (bus.point_count > 1) {
+            writer.AddRoutePoint(segment->to);
+        }
+        last_id = id;
+        last_clipped = segment->to_clipped;
+    }
+    close();
+}
+
+void MapIndex::Render(const Viewport& viewport, std::string& out) const {
+    MapWriter writer(settings_, out);
+    writer.BeginDocument(viewport, buses_.size());
+
+    std::vector<uint32_t> ids;
+    RenderRoutes(viewport, writer, ids);
+
+    Query(labels_grid_, Shifted(viewport, {-settings_.bus_label_offset_.x, -settings_.bus_label_offset_.y}), ids);
+    for (const uint32_t id : ids) {
+        const Label& label = labels_[id];
+        const svg::Point start{label.position.x + settings_.bus_label_offset_.x,
+                               label.position.y + settings_.bus_label_offset_.y};
+        if (Contains(viewport, start)) {
+            writer.WriteBusLabel(label.bus, buses_[label.bus].name, label.position);
+        }
+    }
+
+    Query(stops_grid_, Expanded(viewport, settings_.stop_radius_), ids);
+    for (const uint32_t id : ids) {
+        if (Touches(viewport, stops_[id].position, settings_.stop_radius_)) {
+            writer.WriteStopCircle(stops_[id].position);
+        }
+    }
+
+    Query(stops_grid_, Shifted(viewport, {-settings_.stop_label_offset_.x, -settings_.stop_label_offset_.y}), ids);
+    for (const uint32_t id : ids) {
+        const auto& stop = stops_[id];
+        const svg::Point start{stop.position.x + settings_.stop_label_offset_.x,
+                               stop.position.y + settings_.stop_label_offset_.y};
+        if (Contains(viewport, start)) {
+            writer.WriteStopLabel(stop.name, stop.position);
+        }
+    }
+
+    writer.EndDocument();
+}
+
+void MapRenderer::RenderBusesRoute(const RenderModel& model, const RouteLod::Level* lod, svg::ObjectContainer& doc) const {
+    for (size_t bus_index = 0; bus_index < model.GetBuses().size(); ++bus_index) {
+        svg::Polyline polyline;
+        for (const svg::Point point : BusPoints(model, lod, bus_index)) {
+            polyline.AddPoint(point);
+        }
+
+        polyline.SetFillColor("none")
+               .SetStrokeColor(BusColor(settings_, bus_index))
+               .SetStrokeWidth(settings_.line_width_)
+               .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+               .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+
+        doc.Add(polyline);
+    }
+}
+
+void MapRenderer::RenderBusesNames(const RenderModel& model, svg::ObjectContainer& doc) const {
+    const auto buses = model.GetBuses();
+    for (size_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+        const auto& bus = buses[bus_index];
+        const svg::Color& color = BusColor(settings_, bus_index);
+
+        const auto add_title = [&](svg::Point position) {
+            svg::Text bus_title = svg::Text()
+                .SetFontFamily("Verdana")
+                .SetFontSize(settings_.bus_label_font_size_)
+                .SetPosition(position)
+                .SetOffset({settings_.bus_label_offset_.x, settings_.bus_label_offset_.y})
+                .SetData(std::string(bus.name))
+                .SetFontWeight("bold");
+            doc.Add(svg::Text{bus_title}
                 .SetStrokeColor(settings_.underlayer_color_)
                 .SetFillColor(settings_.underlayer_color_)
                 .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
                 .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
                 .SetStrokeWidth(settings_.underlayer_width_)
                 .SetFontWeight("bold"));
-            doc.Add(svg::Text{bus_title_end}.SetFillColor(color));
+            doc.Add(svg::Text{bus_title}.SetFillColor(color));
+        };
+
+        add_title(bus.start);
+        if (bus.end) {
+            add_title(*bus.end);
         }
-        bus_index++;
-        color_index++;
     }
 }
 
-void MapRenderer::RenderStopsCircles(const transport::TransportCatalogue &catalogue, svg::Document &doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const {
-    std::set<std::string_view> stops_names;
-    for (const auto& name : sorted_bus_names) {
-        const auto* bus = catalogue.FindBus(name);
-        for (const auto* stop : bus->stops) {
-            stops_names.insert(stop->name);
-        }
-    }
-    for (const auto& stop_name : stops_names) {
-        const transport::Stop *stop = catalogue.FindStop(stop_name);
+void MapRenderer::RenderStopsCircles(const RenderModel& model, svg::ObjectContainer& doc) const {
+    for (const auto& stop : model.GetStops()) {
         svg::Circle stop_circle;
-        stop_circle.SetCenter(projector({stop->coordinates}))
+        stop_circle.SetCenter(stop.position)
                     .SetRadius(settings_.stop_radius_)
                     .SetFillColor("white");
         doc.Add(stop_circle);
     }
 }
 
-void MapRenderer::RenderStopsNames(const transport::TransportCatalogue &catalogue, svg::Document &doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const {
-    std::set<std::string_view> stops_names;
-    for (const auto& name : sorted_bus_names) {
-        const auto* bus = catalogue.FindBus(name);
-        for (const auto* stop : bus->stops) {
-            stops_names.insert(stop->name);
-        }
-    }
-    for (const auto& stop_name : stops_names) {
-        const transport::Stop *stop = catalogue.FindStop(stop_name);
-        if (!stop) {
-            continue;
-        }
-
+void MapRenderer::RenderStopsNames(const RenderModel& model, svg::ObjectContainer& doc) const {
+    for (const auto& stop : model.GetStops()) {
          const svg::Text stop_title = svg::Text()
                      .SetFillColor("black")
                      .SetFontFamily("Verdana")
                      .SetFontSize(settings_.stop_label_font_size_)
-                     .SetPosition(projector({stop->coordinates}))
+                     .SetPosition(stop.position)
                      .SetOffset(svg::Point{settings_.stop_label_offset_.x, settings_.stop_label_offset_.y})
-                     .SetData(stop->name);
+                     .SetData(std::string(stop.name));
          doc.Add(svg::Text{stop_title}
              .SetStrokeColor(settings_.underlayer_color_)
              .SetFillColor(settings_.underlayer_color_)
@@ -256,4 +1194,4 @@ void MapRenderer::RenderStopsNames(const transport::TransportCatalogue &catalogu
         doc.Add(stop_title);
     }
 }
-} // namespace renderer
\ No newline at end of file
+} // namespace renderer
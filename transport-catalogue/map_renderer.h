@@ -2,10 +2,16 @@
 
 #include "svg.h"
 #include "transport_catalogue.h"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace renderer {
-    class SphereProjector;
+    class MapWriter;
 
     struct RenderSettings {
         double width_ = 0;
@@ -20,22 +26,282 @@ namespace renderer {
         svg::Color underlayer_color_{};
         double underlayer_width_ = 0;
         std::vector<svg::Color> color_palette_{};
+        // Знаков после точки в координатах, радиусах и смещениях; без значения - шесть значащих цифр
+        std::optional<int> coordinate_precision_{};
+        // Допуск упрощения ломаных маршрутов в пикселях; без значения или 0 - все остановки
+        std::optional<double> simplify_tolerance_{};
+        // Компактный SVG 2 при выводе в строку: оформление в CSS-классах, подложка подписей через paint-order
+        bool compact_svg_ = false;
+
+        bool operator==(const RenderSettings&) const = default;
+    };
+
+    // Хэш всех полей настроек: быстрая проверка ключа кэша карты перед сравнением самих настроек
+    [[nodiscard]] size_t HashRenderSettings(const RenderSettings& settings);
+
+    // Прямоугольник в координатах полной карты (после проекции)
+    struct Viewport {
+        double min_x = 0;
+        double min_y = 0;
+        double max_x = 0;
+        double max_y = 0;
+    };
+
+    // Плитка z/x/y: на уровне z карта width x height делится на 2^z x 2^z равных плиток
+    struct Tile {
+        int z = 0;
+        int x = 0;
+        int y = 0;
     };
 
+    // Бросает std::out_of_range для плитки за пределами уровня z
+    [[nodiscard]] Viewport TileViewport(const RenderSettings& settings, Tile tile);
+
+    // Дописывает в out вершины ломаной points, упрощённой по Дугласу - Пекеру: выброшенные
+    // точки отстоят от итоговой ломаной не дальше tolerance. Концы сохраняются всегда
+    void SimplifyPolyline(std::span<const svg::Point> points, double tolerance, std::vector<svg::Point>& out);
+
+    /*
+     * Геометрия карты без стилей, общая для всех слоёв: автобусы с остановками по алфавиту,
+     * их ломаные и точки подписей, остановки на маршрутах по алфавиту без повторов - всё уже
+     * в координатах холста. Зависит только от каталога и размеров холста, поэтому переживает
+     * смену цветов, шрифтов и смещений. Строки указывают в каталог
+     */
+    class RenderModel {
+    public:
+        // Всё, от чего зависит модель
+        struct Source {
+            const transport::TransportCatalogue* catalogue = nullptr;
+            uint64_t version = 0;
+            double width = 0;
+            double height = 0;
+            double padding = 0;
+
+            bool operator==(const Source&) const = default;
+        };
+
+        struct BusRoute {
+            std::string_view name;
+            // Ломаная туда и, для некольцевого маршрута, обратно
+            uint32_t first_point = 0;
+            uint32_t point_count = 0;
+            svg::Point start;
+            // Вторая подпись: у некольцевого маршрута с разными конечными
+            std::optional<svg::Point> end;
+        };
+
+        struct StopMark {
+            std::string_view name;
+            svg::Point position;
+        };
+
+        RenderModel(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+
+        [[nodiscard]] static Source MakeSource(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        [[nodiscard]] const Source& GetSource() const;
+        // Автобус i рисуется цветом палитры с номером i по модулю её размера
+        [[nodiscard]] std::span<const BusRoute> GetBuses() const;
+        [[nodiscard]] std::span<const svg::Point> GetRoute(const BusRoute& bus) const;
+        // Вершины ломаных всех автобусов подряд
+        [[nodiscard]] std::span<const svg::Point> GetPoints() const;
+        [[nodiscard]] std::span<const StopMark> GetStops() const;
+        [[nodiscard]] memory::Usage GetMemoryUsage() const;
+
+    private:
+        Source source_;
+        std::vector<BusRoute> buses_;
+        std::vector<svg::Point> points_;
+        std::vector<StopMark> stops_;
+    };
+
+    /*
+     * Упрощённые ломаные маршрутов, по уровню на каждый допуск. Уровни
+     * сбрасываются при смене модели: каталога, его версии или размеров холста
+     */
+    class RouteLod {
+    public:
+        struct Level {
+            // Ломаная автобуса i - points[offsets[i]..offsets[i + 1])
+            std::vector<svg::Point> points;
+            std::vector<uint32_t> offsets{0};
+        };
+
+        // Автобусы уровня совпадают с model.GetBuses()
+        const Level& Get(const RenderModel& model, double tolerance);
+        void Clear();
+        // Элементы - точки ломаных всех уровней
+        [[nodiscard]] memory::Usage GetMemoryUsage() const;
+
+    private:
+        RenderModel::Source source_;
+        std::map<double, Level> levels_;
+    };
 
     class MapRenderer {
     public:
         MapRenderer() = default;
 
         void SetSettings(const RenderSettings& settings);
+        // Кэш упрощённых ломаных для RenderMap в строку; без него уровень строится при каждой отрисовке
+        void SetRouteLod(RouteLod* route_lod);
+        // Потоков для RenderMap в строку: 0 - по числу ядер, 1 - последовательно. Результат не зависит от числа
+        void SetThreads(size_t threads);
+        // Формат координат для вывода документов, построенных RenderMap
+        [[nodiscard]] svg::NumberFormat GetNumberFormat() const;
         [[nodiscard]] svg::Document RenderMap(const transport::TransportCatalogue& catalogue) const;
+        // То же с фигурами по значению; массивы фигур резервируются точно по модели карты
+        [[nodiscard]] svg::ValueDocument RenderValueDocument(const transport::TransportCatalogue& catalogue) const;
+        // Добавляет элементы карты в любой контейнер, например в svg::ValueDocument. Документ
+        // всегда полный: компактный режим действует только при выводе в строку
+        void RenderMap(const transport::TransportCatalogue& catalogue, svg::ObjectContainer& container) const;
+        // Дописывает в out разметку, совпадающую с RenderMap(catalogue).Render без компактного режима,
+        // не строя документ
+        void RenderMap(const transport::TransportCatalogue& catalogue, std::string& out) const;
+        // То же по готовой модели, построенной с размерами холста из настроек
+        void RenderMap(const RenderModel& model, svg::ObjectContainer& container) const;
+        void RenderMap(const RenderModel& model, std::string& out) const;
 
     private:
-        void RenderBusesRoute(const transport::TransportCatalogue &catalogue, svg::Document &doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const;
-        void RenderBusesNames(const transport::TransportCatalogue &catalogue, svg::Document& doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const;
-        void RenderStopsCircles(const transport::TransportCatalogue &catalogue, svg::Document& doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const;
-        void RenderStopsNames(const transport::TransportCatalogue &catalogue, svg::Document& doc, const std::set<std::string_view> &sorted_bus_names, const SphereProjector& projector) const;
+        // Уровень упрощения для настроек или nullptr без упрощения; local - на случай без общего кэша
+        const RouteLod::Level* GetLodLevel(const RenderModel& model, RouteLod& local) const;
+        void RenderBusesRoute(const RenderModel& model, const RouteLod::Level* lod, svg::ObjectContainer& doc) const;
+        void RenderBusesNames(const RenderModel& model, svg::ObjectContainer& doc) const;
+        void RenderStopsCircles(const RenderModel& model, svg::ObjectContainer& doc) const;
+        void RenderStopsNames(const RenderModel& model, svg::ObjectContainer& doc) const;
         RenderSettings settings_;
+        RouteLod* route_lod_ = nullptr;
+        size_t threads_ = 1;
+    };
+
+    /*
+     * Спроецированная карта с равномерными сетками по отрезкам маршрутов,
+     * подписям автобусов и остановкам. Отрисовка области перебирает только
+     * ячейки, которые её пересекают, поэтому её время зависит от видимого
+     * содержимого, а не от размера сети. Строки указывают в каталог
+     */
+    class MapIndex {
+    public:
+        MapIndex(const RenderModel& model, const RenderSettings& settings);
+
+        /*
+         * Дописывает в out SVG области viewport в проекции полной карты, с viewBox области.
+         * Ломаные обрезаются по границе области, круги остановок выводятся, если задевают её,
+         * подписи - если в ней лежит начало текста (точка привязки со смещением)
+         */
+        void Render(const Viewport& viewport, std::string& out) const;
+
+        [[nodiscard]] memory::Usage GetMemoryUsage() const;
+
+    private:
+        // Ячейки сетки в сжатом виде: элементы ячейки i - ids[offsets[i]..offsets[i + 1])
+        struct Grid {
+            double cell_width = 1;
+            double cell_height = 1;
+            uint32_t columns = 1;
+            uint32_t rows = 1;
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> ids;
+        };
+
+        struct Label {
+            svg::Point position;
+            uint32_t bus = 0;
+        };
+
+        template <typename Bounds>
+        Grid BuildGrid(size_t count, Bounds bounds) const;
+        // Номера элементов из ячеек, задевающих area, по возрастанию и без повторов
+        void Query(const Grid& grid, const Viewport& area, std::vector<uint32_t>& ids) const;
+
+        // Номер автобуса, которому принадлежит точка points_[point]
+        uint32_t FindBusOfPoint(uint32_t point) const;
+        void RenderRoutes(const Viewport& viewport, MapWriter& writer, std::vector<uint32_t>& ids) const;
+
+        RenderSettings settings_;
+        // Вершины ломаных всех маршрутов подряд; отрезок i соединяет точки i и i + 1 одного маршрута
+        std::vector<svg::Point> points_;
+        std::vector<RenderModel::BusRoute> buses_;
+        std::vector<Label> labels_;
+        std::vector<RenderModel::StopMark> stops_;
+        Grid segments_;
+        Grid labels_grid_;
+        Grid stops_grid_;
+    };
+
+    /*
+     * Готовый SVG карты. Отрисовка повторяется, только если изменились каталог
+     * (его версия или он сам) или настройки; иначе отдаются те же байты - SVG
+     * или готовая строка JSON для ответа.
+     * Модель карты перестраивается, только если изменились каталог или размеры холста
+     */
+    class MapCache {
+    public:
+        // Отрисовки с одним допуском упрощения (0 - без упрощения)
+        struct RenderSample {
+            double tolerance = 0;
+            size_t renders = 0;
+            size_t bytes = 0;
+            double milliseconds = 0;
+        };
+
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t model_builds = 0;
+            std::vector<RenderSample> renders;
+        };
+
+        // Память того, что сейчас в кэше; у строк элементы - символы
+        struct MemoryStats {
+            memory::Usage model;
+            memory::Usage svg;
+            memory::Usage json;
+            memory::Usage index;
+            memory::Usage route_lod;
+        };
+
+        // Строка действительна до следующего промаха или Clear
+        std::string_view Get(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        // SVG полной карты строкой JSON, в кавычках и с экранированием: вставляется в ответ как есть.
+        // Экранируется один раз на отрисовку; сам SVG при этом в кэше не остаётся
+        std::string_view GetJson(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        // Отрисовка мимо кэша SVG, например с другим допуском упрощения; модель и упрощённые ломаные общие
+        std::string Render(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        // Индекс для отрисовки областей, хранится и проверяется так же, как SVG полной карты
+        const MapIndex& GetIndex(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        void Clear();
+        [[nodiscard]] Stats GetStats() const;
+        [[nodiscard]] MemoryStats GetMemoryStats() const;
+        // Потоки отрисовки, как в MapRenderer::SetThreads; по умолчанию по числу ядер
+        void SetThreads(size_t threads);
+
+    private:
+        // Копия настроек в ключе: разные настройки с одинаковым хэшем не должны получить чужую карту
+        struct Key {
+            const transport::TransportCatalogue* catalogue = nullptr;
+            uint64_t version = 0;
+            size_t settings_hash = 0;
+            RenderSettings settings;
+
+            // Настройки сравниваются целиком, только если совпали каталог, версия и хэш
+            [[nodiscard]] bool Matches(const transport::TransportCatalogue& other_catalogue,
+                                       const RenderSettings& other_settings, size_t other_hash) const;
+        };
+
+        static Key MakeKey(const transport::TransportCatalogue& catalogue, const RenderSettings& settings, size_t hash);
+        const RenderModel& GetModel(const transport::TransportCatalogue& catalogue, const RenderSettings& settings);
+        void RenderTo(const RenderModel& model, const RenderSettings& settings, std::string& out);
+
+        Key svg_key_;
+        std::string svg_;
+        Key json_key_;
+        std::string json_;
+        Key index_key_;
+        std::optional<MapIndex> index_;
+        std::optional<RenderModel> model_;
+        RouteLod route_lod_;
+        size_t threads_ = 0;
+        Stats stats_;
     };
 
 } // namespace renderer
\ No newline at end of file
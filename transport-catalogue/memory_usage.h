@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace memory {
+
+    struct Usage {
+        size_t bytes = 0;
+        size_t elements = 0;
+
+        Usage& operator+=(const Usage& other) {
+            bytes += other.bytes;
+            elements += other.elements;
+            return *this;
+        }
+    };
+
+    /*
+     * Оценки занимаемой контейнерами памяти. Размеры служебных частей узлов
+     * повторяют раскладку libstdc++ и не учитывают выравнивание распределителя
+     */
+
+    template <typename Vector>
+    Usage ForVector(const Vector& vector) {
+        return {vector.capacity() * sizeof(typename Vector::value_type), vector.size()};
+    }
+
+    // Короткая строка хранится в самом объекте и памяти в куче не занимает
+    inline Usage ForString(const std::string& str) {
+        const bool on_heap = str.capacity() > std::string().capacity();
+        return {on_heap ? str.capacity() + 1 : 0, str.size()};
+    }
+
+    template <typename Deque>
+    Usage ForDeque(const Deque& deque) {
+        // Элементы хранятся блоками по 512 байт, плюс карта указателей на блоки
+        constexpr size_t block_size = 512;
+        const size_t per_block = sizeof(typename Deque::value_type) < block_size
+            ? block_size / sizeof(typename Deque::value_type) : 1;
+        const size_t blocks = deque.size() / per_block + 1;
+        return {blocks * (per_block * sizeof(typename Deque::value_type) + sizeof(void*)), deque.size()};
+    }
+
+    template <typename HashTable>
+    Usage ForHashTable(const HashTable& table) {
+        // Узел: указатель на следующий, значение и закешированный хеш
+        constexpr size_t node_size = sizeof(void*) + sizeof(typename HashTable::value_type) + sizeof(size_t);
+        return {table.size() * node_size + table.bucket_count() * sizeof(void*), table.size()};
+    }
+
+    template <typename Tree>
+    Usage ForTree(const Tree& tree) {
+        // Узел красно-чёрного дерева: цвет и три указателя
+        constexpr size_t node_size = 4 * sizeof(void*) + sizeof(typename Tree::value_type);
+        return {tree.size() * node_size, tree.size()};
+    }
+
+} // namespace memory
@@ -0,0 +1,132 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace transport {
+
+namespace {
+
+// Читает очередной символ UTF-8; некорректные байты считаются отдельными символами
+char32_t NextCodePoint(std::string_view str, size_t& pos) {
+    const auto lead = static_cast<unsigned char>(str[pos]);
+    size_t length = 1;
+    char32_t code_point = lead;
+    if (lead >= 0xF0) {
+        length = 4;
+        code_point = lead & 0x07;
+    } else if (lead >= 0xE0) {
+        length = 3;
+        code_point = lead & 0x0F;
+    } else if (lead >= 0xC0) {
+        length = 2;
+        code_point = lead & 0x1F;
+    }
+    if (pos + length > str.size()) {
+        ++pos;
+        return lead;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        code_point = (code_point << 6) | (static_cast<unsigned char>(str[pos + i]) & 0x3F);
+    }
+    pos += length;
+    return code_point;
+}
+
+size_t CommonPrefixSize(std::string_view lhs, std::string_view rhs) {
+    const auto [lhs_it, rhs_it] = std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    return lhs_it - lhs.begin();
+}
+
+} // namespace
+
+void NameIndex::Build(std::vector<std::string_view> names) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    names_ = std::move(names);
+}
+
+size_t NameIndex::GetSize() const {
+    return names_.size();
+}
+
+std::vector<std::string_view> NameIndex::FindByPrefix(std::string_view prefix, size_t limit) const {
+    std::vector<std::string_view> result;
+    for (auto it = std::lower_bound(names_.begin(), names_.end(), prefix);
+         it != names_.end() && result.size() < limit && it->starts_with(prefix); ++it) {
+        result.push_back(*it);
+    }
+    return result;
+}
+
+std::vector<std::string_view> NameIndex::FindFuzzy(std::string_view query, size_t max_edits, size_t limit) const {
+    std::vector<char32_t> pattern;
+    for (size_t pos = 0; pos < query.size();) {
+        pattern.push_back(NextCodePoint(query, pos));
+    }
+    const size_t width = pattern.size() + 1;
+    if (pattern.size() <= max_edits) {
+        return FindByPrefix({}, limit);
+    }
+
+    // Стек строк таблицы динамического программирования: строка depth соответствует
+    // первым depth символам текущего имени, offsets[depth] - их длине в байтах
+    std::vector<size_t> rows(width);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::vector<size_t> offsets{0};
+
+    std::vector<std::string_view> result;
+    std::string_view previous;
+    size_t index = 0;
+    while (index < names_.size() && result.size() < limit) {
+        const std::string_view name = names_[index];
+        const size_t common = CommonPrefixSize(previous, name);
+        while (offsets.size() > 1 && offsets.back() > common) {
+            offsets.pop_back();
+            rows.resize(rows.size() - width);
+        }
+        previous = name;
+
+        bool matched = false;
+        bool pruned = false;
+        size_t pos = offsets.back();
+        while (pos < name.size() && !matched && !pruned) {
+            const char32_t symbol = NextCodePoint(name, pos);
+            const size_t prev_row = rows.size() - width;
+            rows.resize(rows.size() + width);
+            const size_t row = prev_row + width;
+            rows[row] = rows[prev_row] + 1;
+            size_t row_min = rows[row];
+            for (size_t j = 1; j < width; ++j) {
+                rows[row + j] = std::min({rows[prev_row + j] + 1,
+                                          rows[row + j - 1] + 1,
+                                          rows[prev_row + j - 1] + (pattern[j - 1] == symbol ? 0 : 1)});
+                row_min = std::min(row_min, rows[row + j]);
+            }
+            offsets.push_back(pos);
+            matched = rows[row + width - 1] <= max_edits;
+            pruned = row_min > max_edits;
+        }
+
+        if (!matched && !pruned) {
+            ++index;
+            continue;
+        }
+        // Результат одинаков для всех имён с тем же префиксом: они идут подряд
+        const std::string_view prefix = name.substr(0, pos);
+        const auto subtree_end = std::partition_point(names_.begin() + index, names_.end(),
+                                                      [prefix](std::string_view other) {
+                                                          return other.starts_with(prefix);
+                                                      });
+        const size_t end = subtree_end - names_.begin();
+        if (matched) {
+            for (; index < end && result.size() < limit; ++index) {
+                result.push_back(names_[index]);
+            }
+        }
+        index = end;
+    }
+    return result;
+}
+
+} // namespace transport
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace transport {
+
+    /*
+     * Отсортированный массив имён для автодополнения.
+     * Отсортированный массив работает как неявное префиксное дерево: имена
+     * с общим префиксом лежат подряд, поэтому поиск по префиксу сводится
+     * к двоичному поиску, а нечёткий поиск переиспользует вычисления для
+     * общих префиксов соседних имён и пропускает целые поддеревья.
+     */
+    class NameIndex {
+    public:
+        NameIndex() = default;
+
+        // Строки должны жить дольше индекса
+        void Build(std::vector<std::string_view> names);
+
+        // Имена, начинающиеся с prefix, в лексикографическом порядке
+        [[nodiscard]] std::vector<std::string_view> FindByPrefix(std::string_view prefix, size_t limit) const;
+
+        // Имена, у которых есть префикс на расстоянии Левенштейна не больше max_edits от query.
+        // Расстояние считается по символам UTF-8
+        [[nodiscard]] std::vector<std::string_view> FindFuzzy(std::string_view query, size_t max_edits, size_t limit) const;
+
+        [[nodiscard]] size_t GetSize() const;
+
+    private:
+        std::vector<std::string_view> names_;
+    };
+
+} // namespace transport
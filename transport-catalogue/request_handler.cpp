@@ -13,5 +13,5 @@ transport::set_names RequestHandler::GetBusesByStop(const std::string_view& stop
 }
 
 svg::Document RequestHandler::RenderMap() const {
-    return svg::Document();
+    return renderer_.RenderMap(db_);
 }
\ No newline at end of file
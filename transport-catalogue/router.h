@@ -29,6 +29,13 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Объём таблицы маршрутов для графа с vertex_count вершинами.
+    // Позволяет оценить затраты памяти до построения маршрутизатора
+    static size_t EstimateTableBytes(size_t vertex_count) {
+        return vertex_count * (sizeof(std::vector<std::optional<RouteInternalData>>)
+                               + vertex_count * sizeof(std::optional<RouteInternalData>));
+    }
+
 private:
     struct RouteInternalData {
         Weight weight;
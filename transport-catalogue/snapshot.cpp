@@ -0,0 +1,504 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace transport::snapshot {
+
+namespace {
+    using namespace std::literals;
+
+    constexpr size_t SECTION_ALIGNMENT = 8;
+
+    uint64_t ComputeChecksum(const char* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint32_t ToU32(size_t value) {
+        if (value > std::numeric_limits<uint32_t>::max()) {
+            throw SnapshotError("Catalogue is too large for snapshot format"s);
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    class ImageBuilder {
+    public:
+        ImageBuilder() {
+            image_.resize(sizeof(Header), '\0');
+        }
+
+        uint64_t StartSection() {
+            image_.resize((image_.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT, '\0');
+            return image_.size();
+        }
+
+        template <typename T>
+        void Append(const T& value) {
+            image_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void AppendBytes(std::string_view bytes) {
+            image_.append(bytes);
+        }
+
+        std::string& Finish(Header header) {
+            header.payload_size = image_.size() - sizeof(Header);
+            header.checksum = ComputeChecksum(image_.data() + sizeof(Header), header.payload_size);
+            std::memcpy(image_.data(), &header, sizeof(Header));
+            return image_;
+        }
+
+    private:
+        std::string image_;
+    };
+
+    // Строковая таблица: одинаковые имена хранятся один раз
+    class StringTable {
+    public:
+        std::pair<uint32_t, uint32_t> Intern(std::string_view str) {
+            if (auto it = offsets_.find(str); it != offsets_.end()) {
+                return {it->second, ToU32(str.size())};
+            }
+            const uint32_t offset = ToU32(data_.size());
+            data_.append(str);
+            offsets_.emplace(str, offset);
+            return {offset, ToU32(str.size())};
+        }
+
+        const std::string& GetData() const {
+            return data_;
+        }
+
+    private:
+        std::string data_;
+        std::unordered_map<std::string_view, uint32_t> offsets_;
+    };
+
+} // namespace
+
+void Save(const TransportCatalogue& catalogue, std::ostream& out) {
+    const auto& stops = catalogue.GetStops();
+    const auto& buses = catalogue.GetBuses();
+
+    std::unordered_map<const Stop*, StopId> stop_ids;
+    stop_ids.reserve(stops.size());
+    for (const auto& stop : stops) {
+        stop_ids.emplace(&stop, ToU32(stop_ids.size()));
+    }
+    std::unordered_map<const Bus*, BusId> bus_ids;
+    bus_ids.reserve(buses.size());
+    for (const auto& bus : buses) {
+        bus_ids.emplace(&bus, ToU32(bus_ids.size()));
+    }
+
+    StringTable strings;
+    std::vector<StopRecord> stop_records;
+    stop_records.reserve(stops.size());
+    std::vector<BusId> stop_buses;
+    std::vector<StopId> stop_order;
+    for (const auto& stop : stops) {
+        const auto [name_offset, name_size] = strings.Intern(stop.name);
+        StopRecord record{stop.coordinates.lat, stop.coordinates.lng, name_offset, name_size, ToU32(stop_buses.size()), 0};
+        // В индекс имён попадают только остановки, доступные через FindStop
+        if (catalogue.FindStop(stop.name) == &stop) {
+            stop_order.push_back(stop_ids.at(&stop));
+            if (const auto bus_names = catalogue.GetBusesByStopName(stop.name)) {
+                for (const auto bus_name : **bus_names) {
+                    stop_buses.push_back(bus_ids.at(catalogue.FindBus(bus_name)));
+                }
+            }
+        }
+        record.buses_count = ToU32(stop_buses.size() - record.buses_begin);
+        stop_records.push_back(record);
+    }
+
+    std::vector<BusRecord> bus_records;
+    bus_records.reserve(buses.size());
+    std::vector<StopId> bus_stops;
+    std::vector<BusId> bus_order;
+    for (const auto& bus : buses) {
+        const auto [name_offset, name_size] = strings.Intern(bus.name);
+        BusRecord record{name_offset, name_size, ToU32(bus_stops.size()), ToU32(bus.stops.size()), bus.is_roundtrip, 0};
+        for (const auto* stop : bus.stops) {
+            bus_stops.push_back(stop_ids.at(stop));
+        }
+        if (catalogue.FindBus(bus.name) == &bus) {
+            bus_order.push_back(bus_ids.at(&bus));
+        }
+        bus_records.push_back(record);
+    }
+
+    const auto by_name = [&strings](const auto& records) {
+        return [&strings, &records](uint32_t lhs, uint32_t rhs) {
+            const std::string& data = strings.GetData();
+            return std::string_view(data).substr(records[lhs].name_offset, records[lhs].name_size)
+                 < std::string_view(data).substr(records[rhs].name_offset, records[rhs].name_size);
+        };
+    };
+    std::sort(stop_order.begin(), stop_order.end(), by_name(stop_records));
+    std::sort(bus_order.begin(), bus_order.end(), by_name(bus_records));
+
+    std::vector<DistanceRecord> distances;
+    distances.reserve(catalogue.GetDistances().size());
+    for (const auto& [stops_pair, distance] : catalogue.GetDistances()) {
+        distances.push_back({stop_ids.at(stops_pair.first), stop_ids.at(stops_pair.second), distance});
+    }
+    std::sort(distances.begin(), distances.end(), [](const DistanceRecord& lhs, const DistanceRecord& rhs) {
+        return std::pair{lhs.from, lhs.to} < std::pair{rhs.from, rhs.to};
+    });
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.stop_count = ToU32(stop_records.size());
+    header.bus_count = ToU32(bus_records.size());
+    header.bus_stop_count = ToU32(bus_stops.size());
+    header.stop_bus_count = ToU32(stop_buses.size());
+    header.distance_count = ToU32(distances.size());
+    header.stop_order_count = ToU32(stop_order.size());
+    header.bus_order_count = ToU32(bus_order.size());
+
+    ImageBuilder image;
+    const auto write_section = [&image](const auto& items) {
+        const uint64_t offset = image.StartSection();
+        for (const auto& item : items) {
+            image.Append(item);
+        }
+        return offset;
+    };
+
+    header.strings_offset = image.StartSection();
+    header.strings_size = strings.GetData().size();
+    image.AppendBytes(strings.GetData());
+    header.stops_offset = write_section(stop_records);
+    header.stop_order_offset = write_section(stop_order);
+    header.buses_offset = write_section(bus_records);
+    header.bus_order_offset = write_section(bus_order);
+    header.bus_stops_offset = write_section(bus_stops);
+    header.stop_buses_offset = write_section(stop_buses);
+    header.distances_offset = write_section(distances);
+
+    const std::string& bytes = image.Finish(header);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) {
+        throw SnapshotError("Failed to write snapshot"s);
+    }
+}
+
+void Save(const TransportCatalogue& catalogue, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw SnapshotError("Failed to open '"s + path + "' for writing"s);
+    }
+    Save(catalogue, out);
+}
+
+MappedCatalogue::MappedCatalogue(const std::string& path, bool verify_checksum) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw SnapshotError("Failed to open snapshot '"s + path + "'"s);
+    }
+    struct stat file_stat{};
+    if (::fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        throw SnapshotError("Failed to stat snapshot '"s + path + "'"s);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ < sizeof(Header)) {
+        ::close(fd);
+        throw SnapshotError("Snapshot '"s + path + "' is truncated"s);
+    }
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw SnapshotError("Failed to map snapshot '"s + path + "'"s);
+    }
+    data_ = static_cast<const char*>(data);
+
+    try {
+        Validate(verify_checksum);
+    } catch (...) {
+        Unmap();
+        throw;
+    }
+}
+
+MappedCatalogue::~MappedCatalogue() {
+    Unmap();
+}
+
+MappedCatalogue::MappedCatalogue(MappedCatalogue&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedCatalogue& MappedCatalogue::operator=(MappedCatalogue&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        header_ = std::exchange(other.header_, nullptr);
+        stops_ = other.stops_;
+        stop_order_ = other.stop_order_;
+        buses_ = other.buses_;
+        bus_order_ = other.bus_order_;
+        bus_stops_ = other.bus_stops_;
+        stop_buses_ = other.stop_buses_;
+        distances_ = other.distances_;
+    }
+    return *this;
+}
+
+void MappedCatalogue::Unmap() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+}
+
+void MappedCatalogue::Validate(bool verify_checksum) {
+    header_ = Section<Header>(0);
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw SnapshotError("Not a transport catalogue snapshot"s);
+    }
+    if (header_->version != VERSION || header_->header_size != sizeof(Header)) {
+        throw SnapshotError("Unsupported snapshot version "s + std::to_string(header_->version));
+    }
+    if (header_->payload_size != size_ - sizeof(Header)) {
+        throw SnapshotError("Snapshot size does not match its header"s);
+    }
+
+    const auto check_section = [this](uint64_t offset, uint64_t count, size_t item_size, size_t alignment) {
+        if (offset % alignment != 0 || offset > size_ || count > (size_ - offset) / item_size) {
+            throw SnapshotError("Snapshot section is out of bounds"s);
+        }
+    };
+    check_section(header_->strings_offset, header_->strings_size, 1, 1);
+    check_section(header_->stops_offset, header_->stop_count, sizeof(StopRecord), alignof(StopRecord));
+    check_section(header_->stop_order_offset, header_->stop_order_count, sizeof(StopId), alignof(StopId));
+    check_section(header_->buses_offset, header_->bus_count, sizeof(BusRecord), alignof(BusRecord));
+    check_section(header_->bus_order_offset, header_->bus_order_count, sizeof(BusId), alignof(BusId));
+    check_section(header_->bus_stops_offset, header_->bus_stop_count, sizeof(StopId), alignof(StopId));
+    check_section(header_->stop_buses_offset, header_->stop_bus_count, sizeof(BusId), alignof(BusId));
+    check_section(header_->distances_offset, header_->distance_count, sizeof(DistanceRecord), alignof(DistanceRecord));
+
+    if (verify_checksum && ComputeChecksum(data_ + sizeof(Header), header_->payload_size) != header_->checksum) {
+        throw SnapshotError("Snapshot checksum mismatch"s);
+    }
+
+    stops_ = Section<StopRecord>(header_->stops_offset);
+    stop_order_ = Section<StopId>(header_->stop_order_offset);
+    buses_ = Section<BusRecord>(header_->buses_offset);
+    bus_order_ = Section<BusId>(header_->bus_order_offset);
+    bus_stops_ = Section<StopId>(header_->bus_stops_offset);
+    stop_buses_ = Section<BusId>(header_->stop_buses_offset);
+    distances_ = Section<DistanceRecord>(header_->distances_offset);
+    // Контрольная сумма не защищает от снимка, собранного с ошибкой, поэтому записи проверяются всегда
+    ValidateRecords();
+}
+
+void MappedCatalogue::ValidateRecords() const {
+    const auto check_range = [](uint64_t begin, uint64_t count, uint64_t size) {
+        if (begin > size || count > size - begin) {
+            throw SnapshotError("Snapshot record points outside its section"s);
+        }
+    };
+    const auto check_ids = [](std::span<const uint32_t> ids, uint32_t count) {
+        if (std::any_of(ids.begin(), ids.end(), [count](uint32_t id) { return id >= count; })) {
+            throw SnapshotError("Snapshot refers to a missing stop or bus"s);
+        }
+    };
+
+    for (const StopRecord& stop : std::span(stops_, header_->stop_count)) {
+        check_range(stop.name_offset, stop.name_size, header_->strings_size);
+        check_range(stop.buses_begin, stop.buses_count, header_->stop_bus_count);
+    }
+    for (const BusRecord& bus : std::span(buses_, header_->bus_count)) {
+        check_range(bus.name_offset, bus.name_size, header_->strings_size);
+        check_range(bus.stops_begin, bus.stops_count, header_->bus_stop_count);
+    }
+    check_ids({stop_order_, header_->stop_order_count}, header_->stop_count);
+    check_ids({bus_order_, header_->bus_order_count}, header_->bus_count);
+    check_ids({bus_stops_, header_->bus_stop_count}, header_->stop_count);
+    check_ids({stop_buses_, header_->stop_bus_count}, header_->bus_count);
+    for (const DistanceRecord& distance : std::span(distances_, header_->distance_count)) {
+        if (distance.from >= header_->stop_count || distance.to >= header_->stop_count) {
+            throw SnapshotError("Snapshot refers to a missing stop or bus"s);
+        }
+    }
+}
+
+std::string_view MappedCatalogue::String(uint32_t offset, uint32_t size) const {
+    return {data_ + header_->strings_offset + offset, size};
+}
+
+size_t MappedCatalogue::GetStopCount() const {
+    return header_->stop_count;
+}
+
+size_t MappedCatalogue::GetBusCount() const {
+    return header_->bus_count;
+}
+
+std::optional<StopId> MappedCatalogue::FindStop(std::string_view name) const {
+    const auto* last = stop_order_ + header_->stop_order_count;
+    const auto* it = std::lower_bound(stop_order_, last, name, [this](StopId id, std::string_view value) {
+        return GetStopName(id) < value;
+    });
+    if (it != last && GetStopName(*it) == name) {
+        return *it;
+    }
+    return std::nullopt;
+}
+
+std::optional<BusId> MappedCatalogue::FindBus(std::string_view name) const {
+    const auto* last = bus_order_ + header_->bus_order_count;
+    const auto* it = std::lower_bound(bus_order_, last, name, [this](BusId id, std::string_view value) {
+        return GetBusName(id) < value;
+    });
+    if (it != last && GetBusName(*it) == name) {
+        return *it;
+    }
+    return std::nullopt;
+}
+
+std::string_view MappedCatalogue::GetStopName(StopId id) const {
+    return String(stops_[id].name_offset, stops_[id].name_size);
+}
+
+geo::Coordinates MappedCatalogue::GetStopCoordinates(StopId id) const {
+    return {stops_[id].lat, stops_[id].lng};
+}
+
+std::string_view MappedCatalogue::GetBusName(BusId id) const {
+    return String(buses_[id].name_offset, buses_[id].name_size);
+}
+
+bool MappedCatalogue::IsRoundtrip(BusId id) const {
+    return buses_[id].is_roundtrip != 0;
+}
+
+std::span<const StopId> MappedCatalogue::GetBusStops(BusId id) const {
+    return {bus_stops_ + buses_[id].stops_begin, buses_[id].stops_count};
+}
+
+std::optional<std::span<const BusId>> MappedCatalogue::GetBusesByStopName(std::string_view name) const {
+    const auto stop = FindStop(name);
+    if (!stop) {
+        return std::nullopt;
+    }
+    return std::span<const BusId>{stop_buses_ + stops_[*stop].buses_begin, stops_[*stop].buses_count};
+}
+
+std::optional<int> MappedCatalogue::GetDistance(StopId from, StopId to) const {
+    const auto* end = distances_ + header_->distance_count;
+    const auto* it = std::lower_bound(distances_, end, std::pair{from, to},
+                                      [](const DistanceRecord& record, const std::pair<StopId, StopId>& key) {
+                                          return std::pair{record.from, record.to} < key;
+                                      });
+    if (it != end && it->from == from && it->to == to) {
+        return it->distance;
+    }
+    return std::nullopt;
+}
+
+std::span<const DistanceRecord> MappedCatalogue::GetDistances() const {
+    return {distances_, header_->distance_count};
+}
+
+int MappedCatalogue::RoadDistance(StopId from, StopId to) const {
+    if (const auto distance = GetDistance(from, to)) {
+        return *distance;
+    }
+    return GetDistance(to, from).value_or(0);
+}
+
+std::optional<TransportCatalogue::BusInfo> MappedCatalogue::GetBusInfo(std::string_view name) const {
+    const auto bus = FindBus(name);
+    if (!bus) {
+        return std::nullopt;
+    }
+    const auto stops = GetBusStops(*bus);
+    if (stops.empty()) {
+        return std::nullopt;
+    }
+
+    TransportCatalogue::BusInfo info;
+    info.stops_count = IsRoundtrip(*bus) ? stops.size() : stops.size() * 2 - 1;
+
+    std::vector<StopId> unique_stops(stops.begin(), stops.end());
+    std::sort(unique_stops.begin(), unique_stops.end());
+    info.unique_stops = std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
+
+    // Порядок суммирования совпадает с TransportCatalogue::GetBusInfo
+    double road_distance = 0.0;
+    double geo_distance = 0.0;
+    for (size_t i = 1; i < stops.size(); ++i) {
+        road_distance += RoadDistance(stops[i - 1], stops[i]);
+        geo_distance += geo::ComputeDistance(GetStopCoordinates(stops[i - 1]), GetStopCoordinates(stops[i]));
+    }
+    if (!IsRoundtrip(*bus)) {
+        for (size_t i = stops.size() - 1; i > 0; --i) {
+            road_distance += RoadDistance(stops[i], stops[i - 1]);
+            geo_distance += geo::ComputeDistance(GetStopCoordinates(stops[i]), GetStopCoordinates(stops[i - 1]));
+        }
+    }
+
+    info.route_length = road_distance;
+    info.curvature = road_distance / geo_distance;
+    return info;
+}
+
+void Restore(const MappedCatalogue& snapshot, TransportCatalogue& catalogue) {
+    if (!catalogue.GetStops().empty() || !catalogue.GetBuses().empty()) {
+        throw SnapshotError("Snapshot can only be restored into an empty catalogue"s);
+    }
+
+    // Удалённые остановки и автобусы остались в снимке, но не находятся по имени
+    const auto is_live_stop = [&snapshot](StopId id) {
+        return snapshot.FindStop(snapshot.GetStopName(id)) == id;
+    };
+    for (StopId id = 0; id < snapshot.GetStopCount(); ++id) {
+        if (is_live_stop(id)) {
+            catalogue.AddStop(snapshot.GetStopName(id), snapshot.GetStopCoordinates(id));
+        }
+    }
+    for (const DistanceRecord& record : snapshot.GetDistances()) {
+        if (is_live_stop(record.from) && is_live_stop(record.to)) {
+            catalogue.AddDistance(catalogue.FindStop(snapshot.GetStopName(record.from)),
+                                  catalogue.FindStop(snapshot.GetStopName(record.to)), record.distance);
+        }
+    }
+
+    std::vector<std::string_view> stop_names;
+    for (BusId id = 0; id < snapshot.GetBusCount(); ++id) {
+        const std::string_view name = snapshot.GetBusName(id);
+        if (snapshot.FindBus(name) != id) {
+            continue;
+        }
+        stop_names.clear();
+        for (const StopId stop : snapshot.GetBusStops(id)) {
+            stop_names.push_back(snapshot.GetStopName(stop));
+        }
+        catalogue.AddBus(name, stop_names, snapshot.IsRoundtrip(id));
+    }
+}
+
+} // namespace transport::snapshot
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace transport::snapshot {
+
+    class SnapshotError : public std::runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    using StopId = uint32_t;
+    using BusId = uint32_t;
+
+    inline constexpr char MAGIC[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+    inline constexpr uint32_t VERSION = 1;
+
+    /*
+     * Заголовок файла снимка. Все числа хранятся в порядке байт машины,
+     * записавшей снимок; смещения секций отсчитываются от начала файла.
+     * Контрольная сумма (FNV-1a) считается по всем байтам после заголовка.
+     */
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t payload_size;
+        uint64_t checksum;
+
+        uint32_t stop_count;
+        uint32_t bus_count;
+        uint32_t bus_stop_count;
+        uint32_t stop_bus_count;
+        uint32_t distance_count;
+        // Количество записей в индексах имён (остановки и автобусы, доступные по имени)
+        uint32_t stop_order_count;
+        uint32_t bus_order_count;
+        uint32_t reserved;
+
+        uint64_t strings_offset;
+        uint64_t strings_size;
+        uint64_t stops_offset;
+        uint64_t stop_order_offset;
+        uint64_t buses_offset;
+        uint64_t bus_order_offset;
+        uint64_t bus_stops_offset;
+        uint64_t stop_buses_offset;
+        uint64_t distances_offset;
+    };
+
+    struct StopRecord {
+        double lat;
+        double lng;
+        uint32_t name_offset;
+        uint32_t name_size;
+        // Диапазон в секции stop_buses: автобусы, отсортированные по имени
+        uint32_t buses_begin;
+        uint32_t buses_count;
+    };
+
+    struct BusRecord {
+        uint32_t name_offset;
+        uint32_t name_size;
+        // Диапазон в секции bus_stops: идентификаторы остановок маршрута
+        uint32_t stops_begin;
+        uint32_t stops_count;
+        uint32_t is_roundtrip;
+        uint32_t reserved;
+    };
+
+    struct DistanceRecord {
+        StopId from;
+        StopId to;
+        int32_t distance;
+    };
+
+    // Записывает снимок каталога в поток
+    void Save(const TransportCatalogue& catalogue, std::ostream& out);
+    void Save(const TransportCatalogue& catalogue, const std::string& path);
+
+    /*
+     * Снимок каталога, отображённый в память через mmap.
+     * Запросы обслуживаются прямо из отображённых страниц: при открытии
+     * проверяются заголовок, контрольная сумма и то, что все смещения и
+     * идентификаторы записей лежат в своих секциях; объекты не создаются.
+     */
+    class MappedCatalogue {
+    public:
+        explicit MappedCatalogue(const std::string& path, bool verify_checksum = true);
+        ~MappedCatalogue();
+
+        MappedCatalogue(const MappedCatalogue&) = delete;
+        MappedCatalogue& operator=(const MappedCatalogue&) = delete;
+        MappedCatalogue(MappedCatalogue&& other) noexcept;
+        MappedCatalogue& operator=(MappedCatalogue&& other) noexcept;
+
+        [[nodiscard]] size_t GetStopCount() const;
+        [[nodiscard]] size_t GetBusCount() const;
+
+        [[nodiscard]] std::optional<StopId> FindStop(std::string_view name) const;
+        [[nodiscard]] std::optional<BusId> FindBus(std::string_view name) const;
+
+        [[nodiscard]] std::string_view GetStopName(StopId id) const;
+        [[nodiscard]] geo::Coordinates GetStopCoordinates(StopId id) const;
+        [[nodiscard]] std::string_view GetBusName(BusId id) const;
+        [[nodiscard]] bool IsRoundtrip(BusId id) const;
+        [[nodiscard]] std::span<const StopId> GetBusStops(BusId id) const;
+
+        // Автобусы, проходящие через остановку, в порядке возрастания имён
+        [[nodiscard]] std::optional<std::span<const BusId>> GetBusesByStopName(std::string_view name) const;
+        [[nodiscard]] std::optional<TransportCatalogue::BusInfo> GetBusInfo(std::string_view name) const;
+        [[nodiscard]] std::optional<int> GetDistance(StopId from, StopId to) const;
+        // Все записи расстояний, упорядоченные по (from, to)
+        [[nodiscard]] std::span<const DistanceRecord> GetDistances() const;
+
+    private:
+        void Validate(bool verify_checksum);
+        void ValidateRecords() const;
+        void Unmap();
+
+        template <typename T>
+        const T* Section(uint64_t offset) const {
+            return reinterpret_cast<const T*>(data_ + offset);
+        }
+
+        std::string_view String(uint32_t offset, uint32_t size) const;
+        int RoadDistance(StopId from, StopId to) const;
+
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        const Header* header_ = nullptr;
+        const StopRecord* stops_ = nullptr;
+        const StopId* stop_order_ = nullptr;
+        const BusRecord* buses_ = nullptr;
+        const BusId* bus_order_ = nullptr;
+        const StopId* bus_stops_ = nullptr;
+        const BusId* stop_buses_ = nullptr;
+        const DistanceRecord* distances_ = nullptr;
+    };
+
+    // Заполняет пустой каталог остановками, расстояниями и автобусами снимка, доступными по имени,
+    // в исходном порядке добавления. Нужен запросам, которые не обслуживаются из снимка напрямую
+    void Restore(const MappedCatalogue& snapshot, TransportCatalogue& catalogue);
+
+} // namespace transport::snapshot
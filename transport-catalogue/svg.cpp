@@ -1,4 +1,8 @@
 #include "svg.h"
+#include "char_scan.h"
+
+#include <algorithm>
+#include <charconv>
 
 namespace svg {
 
@@ -23,8 +27,44 @@ namespace svg {
         void RenderColor(std::ostream& out, Rgba rgba) {
             out << "rgba("sv << static_cast<int>(rgba.red)  //
                 << ',' << static_cast<int>(rgba.green)      //
-                << ',' << static_cast<int>(rgba.blue)       //
-                << ',' << rgba.opacity << ')';
+                << ',' << static_cast<int>(rgba.blue) << ',';
+            detail::WriteNumber(out, rgba.opacity);
+            out << ')';
+        }
+
+        std::string_view ToString(StrokeLineCap value) {
+            switch (value) {
+                case StrokeLineCap::BUTT:
+                    return "butt"sv;
+                case StrokeLineCap::ROUND:
+                    return "round"sv;
+                case StrokeLineCap::SQUARE:
+                    return "square"sv;
+            }
+            return {};
+        }
+
+        std::string_view ToString(StrokeLineJoin value) {
+            switch (value) {
+                case StrokeLineJoin::ARCS:
+                    return "arcs"sv;
+                case StrokeLineJoin::BEVEL:
+                    return "bevel"sv;
+                case StrokeLineJoin::MITER:
+                    return "miter"sv;
+                case StrokeLineJoin::MITER_CLIP:
+                    return "miter-clip"sv;
+                case StrokeLineJoin::ROUND:
+                    return "round"sv;
+            }
+            return {};
+        }
+
+        // Целое без знака, как его выводит ostream
+        void AppendUnsigned(std::string& out, unsigned value) {
+            char buffer[16];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
         }
 
     }  // namespace
@@ -39,41 +79,11 @@ namespace svg {
     }
 
     std::ostream& operator<<(std::ostream& out, StrokeLineCap value) {
-        std::string_view sv;
-        switch (value) {
-            case StrokeLineCap::BUTT:
-                sv = "butt"sv;
-                break;
-            case StrokeLineCap::ROUND:
-                sv = "round"sv;
-                break;
-            case StrokeLineCap::SQUARE:
-                sv = "square"sv;
-                break;
-        }
-        return out << sv;
+        return out << ToString(value);
     }
 
     std::ostream& operator<<(std::ostream& out, StrokeLineJoin value) {
-        std::string_view sv;
-        switch (value) {
-            case StrokeLineJoin::ARCS:
-                sv = "arcs"sv;
-                break;
-            case StrokeLineJoin::BEVEL:
-                sv = "bevel"sv;
-                break;
-            case StrokeLineJoin::MITER:
-                sv = "miter"sv;
-                break;
-            case StrokeLineJoin::MITER_CLIP:
-                sv = "miter-clip"sv;
-                break;
-            case StrokeLineJoin::ROUND:
-                sv = "round"sv;
-                break;
-        }
-        return out << sv;
+        return out << ToString(value);
     }
 
     void Object::Render(const RenderContext& context) const {
@@ -97,10 +107,19 @@ namespace svg {
         return *this;
     }
 
+    size_t Circle::GetMemoryUsage() const {
+        return sizeof(Circle);
+    }
+
     void Circle::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
-        out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-        out << "r=\""sv << radius_ << "\" "sv;
+        out << "<circle cx=\""sv;
+        context.RenderCoordinate(center_.x);
+        out << "\" cy=\""sv;
+        context.RenderCoordinate(center_.y);
+        out << "\" r=\""sv;
+        context.RenderCoordinate(radius_);
+        out << "\" "sv;
         RenderAttrs(out);
         out << "/>"sv;
     }
@@ -112,6 +131,10 @@ namespace svg {
         return *this;
     }
 
+    size_t Polyline::GetMemoryUsage() const {
+        return sizeof(Polyline) + points_.capacity() * sizeof(Point);
+    }
+
     void Polyline::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<polyline points=\""sv;
@@ -122,7 +145,9 @@ namespace svg {
             } else {
                 out << ' ';
             }
-            out << p.x << ',' << p.y;
+            context.RenderCoordinate(p.x);
+            out << ',';
+            context.RenderCoordinate(p.y);
         }
         out << "\" "sv;
         RenderAttrs(out);
@@ -161,15 +186,28 @@ namespace svg {
         return *this;
     }
 
+    size_t Text::GetMemoryUsage() const {
+        // Короткие строки хранятся внутри объекта и не требуют отдельной памяти
+        const auto heap_bytes = [](const std::string& str) -> size_t {
+            return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+        };
+        return sizeof(Text) + heap_bytes(font_family_) + heap_bytes(font_weight_) + heap_bytes(data_);
+    }
+
     void Text::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<text "sv;
         RenderAttrs(out);
+        const auto render_coordinate = [&context](std::string_view name, double value) {
+            context.out << name << "=\""sv;
+            context.RenderCoordinate(value);
+            context.out.put('"');
+        };
+        render_coordinate(" x"sv, position_.x);
+        render_coordinate(" y"sv, position_.y);
+        render_coordinate(" dx"sv, offset_.x);
+        render_coordinate(" dy"sv, offset_.y);
         using detail::RenderAttr;
-        RenderAttr(out, " x"sv, position_.x);
-        RenderAttr(out, " y"sv, position_.y);
-        RenderAttr(out, " dx"sv, offset_.x);
-        RenderAttr(out, " dy"sv, offset_.y);
         RenderAttr(out, " font-size"sv, font_size_);
         if (!font_family_.empty()) {
             RenderAttr(out, " font-family"sv, font_family_);
@@ -188,40 +226,401 @@ namespace svg {
         objects_.push_back(std::move(obj));
     }
 
-    void Document::Render(std::ostream& out) const {
+    memory::Usage Document::GetMemoryUsage() const {
+        memory::Usage usage = memory::ForVector(objects_);
+        for (const auto& obj : objects_) {
+            usage.bytes += obj->GetMemoryUsage();
+        }
+        return usage;
+    }
+
+    void Document::Render(std::ostream& out, NumberFormat coordinates) const {
         out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
         out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
-        RenderContext ctx{out, 2, 2};
+        RenderContext ctx{out, 2, 2, coordinates};
         for (const auto& obj : objects_) {
             obj->Render(ctx);
         }
         out << "</svg>"sv;
     }
 
+// ObjectContainer
+
+    void ObjectContainer::AddShape(Circle&& circle) {
+        AddPtr(std::make_unique<Circle>(std::move(circle)));
+    }
+
+    void ObjectContainer::AddShape(Polyline&& polyline) {
+        AddPtr(std::make_unique<Polyline>(std::move(polyline)));
+    }
+
+    void ObjectContainer::AddShape(Text&& text) {
+        AddPtr(std::make_unique<Text>(std::move(text)));
+    }
+
+// ValueDocument
+
+    void ValueDocument::AddPtr(std::unique_ptr<Object>&& obj) {
+        order_.push_back({Kind::OTHER, static_cast<uint32_t>(others_.size())});
+        others_.push_back(std::move(obj));
+    }
+
+    void ValueDocument::AddShape(Circle&& circle) {
+        order_.push_back({Kind::CIRCLE, static_cast<uint32_t>(circles_.size())});
+        circles_.push_back(std::move(circle));
+    }
+
+    void ValueDocument::AddShape(Polyline&& polyline) {
+        order_.push_back({Kind::POLYLINE, static_cast<uint32_t>(polylines_.size())});
+        polylines_.push_back(std::move(polyline));
+    }
+
+    void ValueDocument::AddShape(Text&& text) {
+        order_.push_back({Kind::TEXT, static_cast<uint32_t>(texts_.size())});
+        texts_.push_back(std::move(text));
+    }
+
+    void ValueDocument::Reserve(size_t circles, size_t polylines, size_t texts) {
+        circles_.reserve(circles);
+        polylines_.reserve(polylines);
+        texts_.reserve(texts);
+        order_.reserve(order_.size() + circles + polylines + texts);
+    }
+
+    void ValueDocument::ShrinkToFit() {
+        circles_.shrink_to_fit();
+        polylines_.shrink_to_fit();
+        texts_.shrink_to_fit();
+        others_.shrink_to_fit();
+        order_.shrink_to_fit();
+    }
+
+    void ValueDocument::Render(std::ostream& out, NumberFormat coordinates) const {
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
+        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+        RenderContext ctx{out, 2, 2, coordinates};
+        for (const auto [kind, index] : order_) {
+            switch (kind) {
+                case Kind::CIRCLE:
+                    circles_[index].Render(ctx);
+                    break;
+                case Kind::POLYLINE:
+                    polylines_[index].Render(ctx);
+                    break;
+                case Kind::TEXT:
+                    texts_[index].Render(ctx);
+                    break;
+                case Kind::OTHER:
+                    others_[index]->Render(ctx);
+                    break;
+            }
+        }
+        out << "</svg>"sv;
+    }
+
+    // Фигуры учитываются вместе с собственными данными, размер их массивов - по ёмкости
+    memory::Usage ValueDocument::GetMemoryUsage() const {
+        memory::Usage usage = memory::ForVector(order_);
+        const auto add_shapes = [&usage](const auto& shapes) {
+            using Shape = typename std::decay_t<decltype(shapes)>::value_type;
+            usage.bytes += (shapes.capacity() - shapes.size()) * sizeof(Shape);
+            for (const auto& shape : shapes) {
+                usage.bytes += shape.GetMemoryUsage();
+            }
+        };
+        add_shapes(circles_);
+        add_shapes(polylines_);
+        add_shapes(texts_);
+        usage.bytes += memory::ForVector(others_).bytes;
+        for (const auto& obj : others_) {
+            usage.bytes += obj->GetMemoryUsage();
+        }
+        return usage;
+    }
+
+    void AppendColor(std::string& out, const Color& color) {
+        if (std::holds_alternative<std::monostate>(color)) {
+            out += "none"sv;
+        } else if (const auto* name = std::get_if<std::string>(&color)) {
+            out += *name;
+        } else if (const auto* rgb = std::get_if<Rgb>(&color)) {
+            out += "rgb("sv;
+            AppendUnsigned(out, rgb->red);
+            out += ',';
+            AppendUnsigned(out, rgb->green);
+            out += ',';
+            AppendUnsigned(out, rgb->blue);
+            out += ')';
+        } else if (const auto* rgba = std::get_if<Rgba>(&color)) {
+            out += "rgba("sv;
+            AppendUnsigned(out, rgba->red);
+            out += ',';
+            AppendUnsigned(out, rgba->green);
+            out += ',';
+            AppendUnsigned(out, rgba->blue);
+            out += ',';
+            detail::AppendNumber(out, rgba->opacity);
+            out += ')';
+        }
+    }
+
+// StreamWriter
+
+    StreamWriter::StreamWriter(std::string& out, NumberFormat coordinates)
+            : out_(out)
+            , coordinates_(coordinates) {
+    }
+
+    void StreamWriter::BeginDocument(bool svg2) {
+        WriteHeader(svg2);
+        out_ += ">\n"sv;
+    }
+
+    void StreamWriter::BeginDocument(const ViewBox& view_box, bool svg2) {
+        WriteHeader(svg2);
+        out_ += " viewBox=\""sv;
+        WriteCoordinate(view_box.x);
+        out_ += ' ';
+        WriteCoordinate(view_box.y);
+        out_ += ' ';
+        WriteCoordinate(view_box.width);
+        out_ += ' ';
+        WriteCoordinate(view_box.height);
+        out_ += "\">\n"sv;
+    }
+
+    void StreamWriter::EndDocument() {
+        out_ += "</svg>"sv;
+    }
+
+    void StreamWriter::WriteCircle(Point center, double radius, const PathAttrs& attrs) {
+        out_ += "  <circle cx=\""sv;
+        WriteCoordinate(center.x);
+        out_ += "\" cy=\""sv;
+        WriteCoordinate(center.y);
+        out_ += "\" r=\""sv;
+        WriteCoordinate(radius);
+        out_ += "\" "sv;
+        WriteAttrs(attrs);
+        out_ += "/>\n"sv;
+    }
+
+    void StreamWriter::BeginPolyline() {
+        out_ += "  <polyline points=\""sv;
+        first_point_ = true;
+    }
+
+    void StreamWriter::AddPolylinePoint(Point point) {
+        if (!first_point_) {
+            out_ += ' ';
+        }
+        first_point_ = false;
+        WriteCoordinate(point.x);
+        out_ += ',';
+        WriteCoordinate(point.y);
+    }
+
+    void StreamWriter::EndPolyline(const PathAttrs& attrs) {
+        out_ += "\" "sv;
+        WriteAttrs(attrs);
+        out_ += "/>\n"sv;
+    }
+
+    void StreamWriter::WriteText(const PathAttrs& attrs, const TextAttrs& text, std::string_view data) {
+        out_ += "  <text "sv;
+        WriteAttrs(attrs);
+        out_ += " x=\""sv;
+        WriteCoordinate(text.position.x);
+        out_ += "\" y=\""sv;
+        WriteCoordinate(text.position.y);
+        out_ += "\" dx=\""sv;
+        WriteCoordinate(text.offset.x);
+        out_ += "\" dy=\""sv;
+        WriteCoordinate(text.offset.y);
+        out_ += "\" font-size=\""sv;
+        AppendUnsigned(out_, text.font_size);
+        out_ += '"';
+        if (!text.font_family.empty()) {
+            out_ += " font-family=\""sv;
+            detail::HtmlEncodeString(out_, text.font_family);
+            out_ += '"';
+        }
+        if (!text.font_weight.empty()) {
+            out_ += " font-weight=\""sv;
+            detail::HtmlEncodeString(out_, text.font_weight);
+            out_ += '"';
+        }
+        out_ += '>';
+        detail::HtmlEncodeString(out_, data);
+        out_ += "</text>\n"sv;
+    }
+
+    void StreamWriter::WriteStyle(std::string_view css) {
+        out_ += "  <style>"sv;
+        detail::HtmlEncodeString(out_, css);
+        out_ += "</style>\n"sv;
+    }
+
+    void StreamWriter::EndPolyline(std::string_view class_names) {
+        out_ += "\" class=\""sv;
+        out_ += class_names;
+        out_ += "\"/>\n"sv;
+    }
+
+    void StreamWriter::WriteText(std::string_view class_names, Point position, std::string_view data) {
+        out_ += "  <text class=\""sv;
+        out_ += class_names;
+        out_ += "\" x=\""sv;
+        WriteCoordinate(position.x);
+        out_ += "\" y=\""sv;
+        WriteCoordinate(position.y);
+        out_ += "\">"sv;
+        detail::HtmlEncodeString(out_, data);
+        out_ += "</text>\n"sv;
+    }
+
+    void StreamWriter::WriteCircleDef(std::string_view id, double radius, const PathAttrs& attrs) {
+        out_ += "  <defs><circle id=\""sv;
+        out_ += id;
+        out_ += "\" r=\""sv;
+        WriteCoordinate(radius);
+        out_ += "\" "sv;
+        WriteAttrs(attrs);
+        out_ += "/></defs>\n"sv;
+    }
+
+    void StreamWriter::WriteUse(std::string_view id, Point position) {
+        out_ += "  <use href=\"#"sv;
+        out_ += id;
+        out_ += "\" x=\""sv;
+        WriteCoordinate(position.x);
+        out_ += "\" y=\""sv;
+        WriteCoordinate(position.y);
+        out_ += "\"/>\n"sv;
+    }
+
+    void StreamWriter::WriteHeader(bool svg2) {
+        out_ += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        out_ += "<svg xmlns=\"http://www.w3.org/2000/svg\""sv;
+        if (!svg2) {
+            out_ += " version=\"1.1\""sv;
+        }
+    }
+
+    void StreamWriter::WriteCoordinate(double value) {
+        detail::AppendNumber(out_, value, coordinates_);
+    }
+
+    void StreamWriter::WriteColor(const Color& color) {
+        AppendColor(out_, color);
+    }
+
+    // Порядок и пробелы как в PathProps::RenderAttrs
+    void StreamWriter::WriteAttrs(const PathAttrs& attrs) {
+        if (attrs.fill) {
+            out_ += "fill=\""sv;
+            WriteColor(*attrs.fill);
+            out_ += '"';
+        }
+        if (attrs.stroke) {
+            out_ += " stroke=\""sv;
+            WriteColor(*attrs.stroke);
+            out_ += '"';
+        }
+        if (attrs.stroke_width) {
+            out_ += " stroke-width=\""sv;
+            detail::AppendNumber(out_, *attrs.stroke_width);
+            out_ += '"';
+        }
+        if (attrs.stroke_line_cap) {
+            out_ += " stroke-linecap=\""sv;
+            out_ += ToString(*attrs.stroke_line_cap);
+            out_ += '"';
+        }
+        if (attrs.stroke_line_join) {
+            out_ += " stroke-linejoin=\""sv;
+            out_ += ToString(*attrs.stroke_line_join);
+            out_ += '"';
+        }
+    }
+
     namespace detail {
 
-        void HtmlEncodeString(std::ostream& out, std::string_view sv) {
-            for (char c : sv) {
+        // По умолчанию совпадает с ostream: %g с шестью значащими цифрами
+        std::string_view FormatNumber(char* buffer, double value, NumberFormat format) {
+            char* const end = buffer + NUMBER_BUFFER_SIZE;
+            if (format.decimals) {
+                const int decimals = std::clamp(*format.decimals, 0, 17);
+                if (const auto result = std::to_chars(buffer, end, value, std::chars_format::fixed, decimals);
+                    result.ec == std::errc{}) {
+                    std::string_view text(buffer, result.ptr - buffer);
+                    if (decimals > 0) {
+                        text.remove_suffix(text.size() - 1 - text.find_last_not_of('0'));
+                        if (text.back() == '.') {
+                            text.remove_suffix(1);
+                        }
+                    }
+                    return text == "-0"sv ? "0"sv : text;
+                }
+                // Очень большие числа не помещаются в фиксированную запись и выводятся как по умолчанию
+            }
+            const auto result = std::to_chars(buffer, end, value, std::chars_format::general, 6);
+            return {buffer, static_cast<size_t>(result.ptr - buffer)};
+        }
+
+        void WriteNumber(std::ostream& out, double value, NumberFormat format) {
+            char buffer[NUMBER_BUFFER_SIZE];
+            out << FormatNumber(buffer, value, format);
+        }
+
+        void AppendNumber(std::string& out, double value, NumberFormat format) {
+            char buffer[NUMBER_BUFFER_SIZE];
+            out += FormatNumber(buffer, value, format);
+        }
+
+        namespace {
+
+            size_t FindSpecial(std::string_view sv, size_t pos) {
+                return scan::FindFirstOf<'"', '<', '>', '&', '\''>(sv, pos);
+            }
+
+            std::string_view EncodeSpecial(char c) {
                 switch (c) {
                     case '"':
-                        out << "&quot;"sv;
-                        break;
+                        return "&quot;"sv;
                     case '<':
-                        out << "&lt;"sv;
-                        break;
+                        return "&lt;"sv;
                     case '>':
-                        out << "&gt;"sv;
-                        break;
+                        return "&gt;"sv;
                     case '&':
-                        out << "&amp;"sv;
-                        break;
+                        return "&amp;"sv;
                     case '\'':
-                        out << "&apos;"sv;
-                        break;
-                    default:
-                        out.put(c);
+                        return "&apos;"sv;
                 }
+                return {};
+            }
+
+        }  // namespace
+
+        // Участки без специальных символов выводятся целиком
+        void HtmlEncodeString(std::ostream& out, std::string_view sv) {
+            size_t plain_start = 0;
+            for (size_t i = FindSpecial(sv, 0); i < sv.size(); i = FindSpecial(sv, i + 1)) {
+                out.write(sv.data() + plain_start, static_cast<std::streamsize>(i - plain_start));
+                out << EncodeSpecial(sv[i]);
+                plain_start = i + 1;
+            }
+            out.write(sv.data() + plain_start, static_cast<std::streamsize>(sv.size() - plain_start));
+        }
+
+        void HtmlEncodeString(std::string& out, std::string_view sv) {
+            size_t plain_start = 0;
+            for (size_t i = FindSpecial(sv, 0); i < sv.size(); i = FindSpecial(sv, i + 1)) {
+                out.append(sv, plain_start, i - plain_start);
+                out += EncodeSpecial(sv[i]);
+                plain_start = i + 1;
             }
+            out.append(sv, plain_start);
         }
 
     }  // namespace detail
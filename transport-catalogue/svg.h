@@ -1,29 +1,54 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <variant>
 #include <vector>
 #include <iomanip>
 
+#include "memory_usage.h"
+
 namespace svg {
 
+    /*
+     * Формат чисел. По умолчанию как у ostream: шесть значащих цифр.
+     * С decimals - не больше decimals знаков после точки, конечные нули отбрасываются
+     */
+    struct NumberFormat {
+        std::optional<int> decimals;
+    };
+
     namespace detail {
 
+        // Записывает value в buffer и возвращает запись; buffer должен быть не короче NUMBER_BUFFER_SIZE
+        inline constexpr size_t NUMBER_BUFFER_SIZE = 64;
+        std::string_view FormatNumber(char* buffer, double value, NumberFormat format = {});
+
+        void WriteNumber(std::ostream& out, double value, NumberFormat format = {});
+        void AppendNumber(std::string& out, double value, NumberFormat format = {});
+
         template <typename T>
         inline void RenderValue(std::ostream& out, const T& value) {
             out << value;
         }
 
         void HtmlEncodeString(std::ostream& out, std::string_view sv);
+        void HtmlEncodeString(std::string& out, std::string_view sv);
 
         template <>
         inline void RenderValue<std::string>(std::ostream& out, const std::string& s) {
             HtmlEncodeString(out, s);
         }
 
+        template <>
+        inline void RenderValue<double>(std::ostream& out, const double& value) {
+            WriteNumber(out, value);
+        }
+
         template <typename AttrType>
         inline void RenderAttr(std::ostream& out, std::string_view name, const AttrType& value) {
             using namespace std::literals;
@@ -50,6 +75,8 @@ namespace svg {
         }
         double x = 0;
         double y = 0;
+
+        bool operator==(const Point&) const = default;
     };
 
     struct Rgb {
@@ -62,6 +89,8 @@ namespace svg {
         uint8_t red = 0;
         uint8_t green = 0;
         uint8_t blue = 0;
+
+        bool operator==(const Rgb&) const = default;
     };
 
     struct Rgba {
@@ -77,12 +106,16 @@ namespace svg {
         uint8_t green = 0;
         uint8_t blue = 0;
         double opacity = 1.0;
+
+        bool operator==(const Rgba&) const = default;
     };
 
     using Color = std::variant<std::monostate, std::string, Rgb, Rgba>;
     inline const Color NoneColor{};
 
     std::ostream& operator<<(std::ostream& out, const Color& color);
+    // Дописывает цвет в той же записи, что и operator<<, например при сборке CSS
+    void AppendColor(std::string& out, const Color& color);
 
 /*
  * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
@@ -93,14 +126,20 @@ namespace svg {
                 : out(out) {
         }
 
-        RenderContext(std::ostream& out, int indent_step, int indent = 0)
+        RenderContext(std::ostream& out, int indent_step, int indent = 0, NumberFormat coordinates = {})
                 : out(out)
                 , indent_step(indent_step)
-                , indent(indent) {
+                , indent(indent)
+                , coordinates(coordinates) {
         }
 
         RenderContext Indented() const {
-            return {out, indent_step, indent + indent_step};
+            return {out, indent_step, indent + indent_step, coordinates};
+        }
+
+        // Координаты, радиусы и смещения выводятся в формате coordinates
+        void RenderCoordinate(double value) const {
+            detail::WriteNumber(out, value, coordinates);
         }
 
         void RenderIndent() const {
@@ -112,6 +151,7 @@ namespace svg {
         std::ostream& out;
         int indent_step = 0;
         int indent = 0;
+        NumberFormat coordinates;
     };
 
 /*
@@ -123,6 +163,9 @@ namespace svg {
     public:
         void Render(const RenderContext& context) const;
 
+        // Объём памяти, занимаемый объектом вместе с его динамическими данными
+        virtual size_t GetMemoryUsage() const = 0;
+
         virtual ~Object() = default;
 
     private:
@@ -204,11 +247,13 @@ namespace svg {
  * Унаследовавшись от PathProps<Circle>, мы "сообщаем" родителю,
  * что владельцем свойств является класс Circle
  */
-    class Circle : public Object, public PathProps<Circle> {
+    class Circle final : public Object, public PathProps<Circle> {
     public:
         Circle& SetCenter(Point center);
         Circle& SetRadius(double radius);
 
+        size_t GetMemoryUsage() const override;
+
     private:
         void RenderObject(const RenderContext& context) const override;
 
@@ -220,11 +265,13 @@ namespace svg {
  * Класс Polyline моделирует элемент <polyline> для отображения ломаных линий
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/polyline
  */
-    class Polyline : public Object, public PathProps<Polyline> {
+    class Polyline final : public Object, public PathProps<Polyline> {
     public:
         // Добавляет очередную вершину к ломаной линии
         Polyline& AddPoint(Point point);
 
+        size_t GetMemoryUsage() const override;
+
     private:
         void RenderObject(const RenderContext& context) const override;
         std::vector<Point> points_;
@@ -234,7 +281,7 @@ namespace svg {
  * Класс Text моделирует элемент <text> для отображения текста
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/text
  */
-    class Text : public Object, public PathProps<Text> {
+    class Text final : public Object, public PathProps<Text> {
     public:
         // Задаёт координаты опорной точки (атрибуты x и y)
         Text& SetPosition(Point pos);
@@ -254,6 +301,8 @@ namespace svg {
         // Задаёт текстовое содержимое объекта (отображается внутри тэга text)
         Text& SetData(std::string data);
 
+        size_t GetMemoryUsage() const override;
+
     private:
         void RenderObject(const RenderContext& context) const override;
         Point position_;
@@ -271,12 +320,23 @@ namespace svg {
     public:
         template <typename ObjectType>
         void Add(ObjectType object) {
-            AddPtr(std::make_unique<ObjectType>(std::move(object)));
+            if constexpr (std::is_same_v<ObjectType, Circle> || std::is_same_v<ObjectType, Polyline>
+                          || std::is_same_v<ObjectType, Text>) {
+                AddShape(std::move(object));
+            } else {
+                AddPtr(std::make_unique<ObjectType>(std::move(object)));
+            }
         }
 
         // Добавляет в svg-документ объект-наследник svg::Object
         virtual void AddPtr(std::unique_ptr<Object>&& obj) = 0;
 
+        // Стандартные фигуры; контейнер может хранить их по значению.
+        // По умолчанию они размещаются в куче и передаются в AddPtr
+        virtual void AddShape(Circle&& circle);
+        virtual void AddShape(Polyline&& polyline);
+        virtual void AddShape(Text&& text);
+
     protected:
         // Интерфейс не предполагает полиморфное удаление
         // Поэтому деструктор объявлен защищённым невиртуальным
@@ -302,10 +362,121 @@ namespace svg {
         void AddPtr(std::unique_ptr<Object>&& obj) override;
 
         // Выводит в ostream svg-представление документа
-        void Render(std::ostream& out) const;
+        void Render(std::ostream& out, NumberFormat coordinates = {}) const;
+
+        // Память, занимаемая документом: вектор указателей и сами объекты
+        memory::Usage GetMemoryUsage() const;
 
     private:
         std::vector<std::unique_ptr<Object>> objects_;
     };
 
+/*
+ * Документ, хранящий стандартные фигуры по значению в отдельном непрерывном
+ * массиве для каждого типа, без выделения памяти и виртуального вызова на фигуру.
+ * Порядок добавления хранится отдельным списком и соблюдается при выводе;
+ * прочие объекты, добавленные через AddPtr, занимают в нём своё место
+ */
+    class ValueDocument final : public ObjectContainer {
+    public:
+        void AddPtr(std::unique_ptr<Object>&& obj) override;
+        void AddShape(Circle&& circle) override;
+        void AddShape(Polyline&& polyline) override;
+        void AddShape(Text&& text) override;
+
+        // Резервирует место под фигуры, если их число известно заранее
+        void Reserve(size_t circles, size_t polylines, size_t texts);
+        // Отдаёт запас ёмкости массивов; для документов, которые хранятся после построения
+        void ShrinkToFit();
+
+        // Вывод совпадает с Document::Render для тех же объектов
+        void Render(std::ostream& out, NumberFormat coordinates = {}) const;
+
+        memory::Usage GetMemoryUsage() const;
+
+    private:
+        enum class Kind : uint8_t {
+            CIRCLE,
+            POLYLINE,
+            TEXT,
+            OTHER
+        };
+
+        struct Entry {
+            Kind kind;
+            uint32_t index;
+        };
+
+        std::vector<Circle> circles_;
+        std::vector<Polyline> polylines_;
+        std::vector<Text> texts_;
+        std::vector<std::unique_ptr<Object>> others_;
+        std::vector<Entry> order_;
+    };
+
+/*
+ * Выводит разметку SVG прямо в строку, не создавая объектов документа.
+ * Для тех же элементов в том же порядке результат совпадает с Document::Render
+ */
+    class StreamWriter {
+    public:
+        // Свойства PathProps без владения: цвета должны жить до вывода элемента
+        struct PathAttrs {
+            const Color* fill = nullptr;
+            const Color* stroke = nullptr;
+            std::optional<double> stroke_width;
+            std::optional<StrokeLineCap> stroke_line_cap;
+            std::optional<StrokeLineJoin> stroke_line_join;
+        };
+
+        struct TextAttrs {
+            Point position;
+            Point offset;
+            uint32_t font_size = 1;
+            std::string_view font_family;
+            std::string_view font_weight;
+        };
+
+        // Видимая область документа (атрибут viewBox)
+        struct ViewBox {
+            double x = 0;
+            double y = 0;
+            double width = 0;
+            double height = 0;
+        };
+
+        explicit StreamWriter(std::string& out, NumberFormat coordinates = {});
+
+        // svg2 - документ SVG 2 без атрибута version: в нём есть <use href> и paint-order,
+        // на которые опирается WriteUse и компактная карта
+        void BeginDocument(bool svg2 = false);
+        void BeginDocument(const ViewBox& view_box, bool svg2 = false);
+        void EndDocument();
+
+        void WriteCircle(Point center, double radius, const PathAttrs& attrs);
+        // Вершины ломаной передаются по одной между BeginPolyline и EndPolyline
+        void BeginPolyline();
+        void AddPolylinePoint(Point point);
+        void EndPolyline(const PathAttrs& attrs);
+        void WriteText(const PathAttrs& attrs, const TextAttrs& text, std::string_view data);
+
+        // Элементы со стилем из CSS-классов: class_names - имена классов через пробел
+        void WriteStyle(std::string_view css);
+        void EndPolyline(std::string_view class_names);
+        void WriteText(std::string_view class_names, Point position, std::string_view data);
+        // Круг в <defs> и его повторы через <use> со сдвигом центра в position
+        void WriteCircleDef(std::string_view id, double radius, const PathAttrs& attrs);
+        void WriteUse(std::string_view id, Point position);
+
+    private:
+        void WriteHeader(bool svg2);
+        void WriteCoordinate(double value);
+        void WriteColor(const Color& color);
+        void WriteAttrs(const PathAttrs& attrs);
+
+        std::string& out_;
+        NumberFormat coordinates_;
+        bool first_point_ = true;
+    };
+
 }  // namespace svg
\ No newline at end of file
@@ -1,11 +1,23 @@
 #include "transport_catalogue.h"
+#include <algorithm>
 #include <unordered_set>
 #include <iostream>
+#include <stdexcept>
 
 namespace transport {
 
     TransportCatalogue::TransportCatalogue()
-    : router_(new TransportRouter()) {}
+    : pool_(std::pmr::pool_options{.max_blocks_per_chunk = 0, .largest_required_pool_block = 64 * 1024}, &arena_)
+    , stops_(&arena_)
+    , buses_(&arena_)
+    , stop_name_to_stop_(&pool_)
+    , bus_name_to_bus_(&pool_)
+    , stop_name_to_buses_(&pool_)
+    , empty_buses_set_(&arena_)
+    , distances_between_stops_(&arena_)
+    , retired_stops_(&pool_)
+    , retired_buses_(&pool_)
+    , router_(new TransportRouter()) {}
 
     TransportCatalogue::~TransportCatalogue() {
         if (router_) {
@@ -14,22 +26,146 @@ namespace transport {
         router_ = nullptr;
     }
 
-    void TransportCatalogue::AddStop(std::string name, geo::Coordinates coords) {
-        stops_.push_back({name, coords});
+    void TransportCatalogue::AddStop(std::string_view name, geo::Coordinates coords) {
+        ++version_;
+        stops_.push_back({arena_.StoreString(name), coords});
         stop_name_to_stop_[stops_.back().name] = &stops_.back();
     }
 
-    void TransportCatalogue::AddBus(std::string name, const std::vector<std::string_view>& stop_names, bool is_roundtrip) {
+    void TransportCatalogue::AddBus(std::string_view name, std::span<const std::string_view> stop_names, bool is_roundtrip) {
         if (name.empty()) return;
-        buses_.push_back({ std::move(name), {}, is_roundtrip });
+        ++version_;
+        buses_.push_back({ arena_.StoreString(name), {}, is_roundtrip });
         Bus& bus = buses_.back();
+        AttachBusToStops(bus, stop_names);
+        bus_name_to_bus_[bus.name] = &bus;
+    }
+
+    void TransportCatalogue::AttachBusToStops(Bus& bus, std::span<const std::string_view> stop_names) {
+        // Массив выделяется точно по числу найденных остановок, чтобы его можно было вернуть в пул
+        route_buffer_.clear();
         for (const auto& stop_name : stop_names) {
             if (auto it = stop_name_to_stop_.find(stop_name); it != stop_name_to_stop_.end()) {
-                bus.stops.push_back(it->second);
+                route_buffer_.push_back(it->second);
                 stop_name_to_buses_[it->first].insert(bus.name);
             }
         }
-        bus_name_to_bus_[bus.name] = &bus;
+        bus.stops = {};
+        if (!route_buffer_.empty()) {
+            auto* stops = static_cast<const Stop**>(pool_.allocate(route_buffer_.size() * sizeof(const Stop*), alignof(const Stop*)));
+            std::copy(route_buffer_.begin(), route_buffer_.end(), stops);
+            bus.stops = {stops, route_buffer_.size()};
+        }
+    }
+
+    void TransportCatalogue::ReleaseRoute(Bus& bus) {
+        if (!bus.stops.empty()) {
+            pool_.deallocate(const_cast<const Stop**>(bus.stops.data()), bus.stops.size() * sizeof(const Stop*), alignof(const Stop*));
+            bus.stops = {};
+        }
+    }
+
+    void TransportCatalogue::DetachBusFromStops(const Bus& bus) {
+        for (const auto* stop : bus.stops) {
+            if (auto it = stop_name_to_buses_.find(stop->name); it != stop_name_to_buses_.end()) {
+                it->second.erase(bus.name);
+                if (it->second.empty()) {
+                    stop_name_to_buses_.erase(it);
+                }
+            }
+        }
+    }
+
+    // Удалённые остановки и автобусы остаются в stops_ и buses_, чтобы не инвалидировать
+    // указатели на них, но исключаются из индексов по имени. При повторном добавлении
+    // автобус с тем же именем занимает прежний объект, а остановка - прежнюю строку имени
+
+    TransportCatalogue::Invalidation TransportCatalogue::UpsertStop(std::string_view name, geo::Coordinates coords) {
+        if (auto it = stop_name_to_stop_.find(name); it != stop_name_to_stop_.end()) {
+            ++version_;
+            it->second->coordinates = coords;
+            // Граф маршрутов не зависит от координат, а на карте видны только остановки с автобусами
+            return {false, stop_name_to_buses_.contains(name), false};
+        }
+        if (auto retired = retired_stops_.find(name); retired != retired_stops_.end()) {
+            // Объект новый, чтобы расстояния до удалённой остановки остались недостижимы
+            ++version_;
+            stops_.push_back({retired->second->name, coords});
+            retired_stops_.erase(retired);
+            stop_name_to_stop_[stops_.back().name] = &stops_.back();
+            return {true, false, true};
+        }
+        AddStop(name, coords);
+        return {true, false, true};
+    }
+
+    TransportCatalogue::Invalidation TransportCatalogue::RemoveStop(std::string_view name) {
+        auto it = stop_name_to_stop_.find(name);
+        if (it == stop_name_to_stop_.end()) {
+            return {};
+        }
+        if (stop_name_to_buses_.contains(name)) {
+            throw std::logic_error("Stop '" + std::string(name) + "' is still used by buses");
+        }
+        ++version_;
+        // Расстояния от удалённой остановки остаются в таблице, но недостижимы:
+        // повторно добавленная остановка с тем же именем получит новый адрес
+        it->second->retired = true;
+        retired_stops_[it->first] = it->second;
+        stop_name_to_stop_.erase(it);
+        return {true, false, true};
+    }
+
+    TransportCatalogue::Invalidation TransportCatalogue::UpsertBus(std::string_view name, std::span<const std::string_view> stop_names, bool is_roundtrip) {
+        if (auto it = bus_name_to_bus_.find(name); it != bus_name_to_bus_.end()) {
+            ++version_;
+            Bus& bus = *it->second;
+            DetachBusFromStops(bus);
+            ReleaseRoute(bus);
+            bus.is_roundtrip = is_roundtrip;
+            AttachBusToStops(bus, stop_names);
+            return {true, true, false};
+        }
+        if (name.empty()) {
+            return {};
+        }
+        if (auto retired = retired_buses_.find(name); retired != retired_buses_.end()) {
+            ++version_;
+            Bus& bus = *retired->second;
+            retired_buses_.erase(retired);
+            bus.retired = false;
+            bus.is_roundtrip = is_roundtrip;
+            AttachBusToStops(bus, stop_names);
+            bus_name_to_bus_[bus.name] = &bus;
+            return {true, true, true};
+        }
+        AddBus(name, stop_names, is_roundtrip);
+        return {true, true, true};
+    }
+
+    TransportCatalogue::Invalidation TransportCatalogue::RemoveBus(std::string_view name) {
+        auto it = bus_name_to_bus_.find(name);
+        if (it == bus_name_to_bus_.end()) {
+            return {};
+        }
+        ++version_;
+        DetachBusFromStops(*it->second);
+        ReleaseRoute(*it->second);
+        it->second->retired = true;
+        retired_buses_[it->first] = it->second;
+        bus_name_to_bus_.erase(it);
+        return {true, true, true};
+    }
+
+    TransportCatalogue::Invalidation TransportCatalogue::SetDistance(std::string_view from, std::string_view to, int distance) {
+        const Stop* from_stop = FindStop(from);
+        const Stop* to_stop = FindStop(to);
+        // Прежнее расстояние не меняет ни маршрутизатор, ни версию каталога с её кэшами
+        if (!from_stop || !to_stop || GetDistance(from_stop, to_stop) == distance) {
+            return {};
+        }
+        AddDistance(from_stop, to_stop, distance);
+        return {true, false, false};
     }
 
     const Stop* TransportCatalogue::FindStop(std::string_view name) const {
@@ -111,18 +247,18 @@ namespace transport {
     std::set<std::string_view> TransportCatalogue::GetBusNames() const {
         std::set<std::string_view> bus_names;
         for (const auto& name : buses_) {
-            if (!name.name.empty()) {
+            if (!name.name.empty() && !name.retired) {
                 bus_names.insert(name.name);
             }
         }
         return bus_names;
     }
 
-    const std::deque<Stop>& TransportCatalogue::GetStops() const {
+    const stops_storage& TransportCatalogue::GetStops() const {
         return stops_;
     }
 
-    const std::deque<Bus> & TransportCatalogue::GetBuses() const {
+    const buses_storage& TransportCatalogue::GetBuses() const {
         return buses_;
     }
 
@@ -134,12 +270,17 @@ namespace transport {
         return {};
     }
 
+    const map_distances& TransportCatalogue::GetDistances() const {
+        return distances_between_stops_;
+    }
+
     void TransportCatalogue::AddDistance(const Stop* from, const Stop* to, int distance) {
+        ++version_;
         distances_between_stops_[std::make_pair(const_cast<Stop*>(from), const_cast<Stop*>(to))] = distance;
     }
 
     std::optional<RouteInfo> TransportCatalogue::FindRoute(
-    const std::string& from, const std::string& to) const {
+    std::string_view from, std::string_view to) const {
         return std::optional<RouteInfo>(router_->FindRoute(from, to));
     }
 
@@ -150,4 +291,70 @@ namespace transport {
     void TransportCatalogue::BuildRouter() {
         router_->BuildGraph(*this);
     }
+
+    AllocationStats TransportCatalogue::GetAllocationStats() const {
+        return arena_.GetStats();
+    }
+
+    TransportCatalogue::MemoryStats TransportCatalogue::GetMemoryStats() const {
+        MemoryStats stats;
+        stats.stops = memory::ForDeque(stops_);
+        stats.buses = memory::ForDeque(buses_);
+        size_t retired_stops = 0;
+        for (const auto& stop : stops_) {
+            stats.names += {stop.name.size(), 1};
+            retired_stops += stop.retired;
+        }
+        for (const auto& bus : buses_) {
+            stats.names += {bus.name.size(), 1};
+            stats.bus_stops += {bus.stops.size() * sizeof(const Stop*), bus.stops.size()};
+        }
+        stats.stop_index = memory::ForHashTable(stop_name_to_stop_);
+        stats.bus_index = memory::ForHashTable(bus_name_to_bus_);
+        stats.stop_buses = memory::ForHashTable(stop_name_to_buses_);
+        for (const auto& [_, buses] : stop_name_to_buses_) {
+            const memory::Usage set_usage = memory::ForTree(buses);
+            stats.stop_buses.bytes += set_usage.bytes;
+        }
+        stats.distances = memory::ForHashTable(distances_between_stops_);
+        stats.retired = {retired_stops * sizeof(Stop) + retired_buses_.size() * sizeof(Bus),
+                         retired_stops + retired_buses_.size()};
+        return stats;
+    }
+
+    const TransportRouter& TransportCatalogue::GetRouter() const {
+        return *router_;
+    }
+
+    void TransportCatalogue::BuildNameIndex() {
+        std::vector<std::string_view> names;
+        names.reserve(stop_name_to_stop_.size());
+        for (const auto& [name, _] : stop_name_to_stop_) {
+            names.push_back(name);
+        }
+        stop_name_index_.Build(std::move(names));
+
+        names.clear();
+        names.reserve(bus_name_to_bus_.size());
+        for (const auto& [name, _] : bus_name_to_bus_) {
+            names.push_back(name);
+        }
+        bus_name_index_.Build(std::move(names));
+    }
+
+    const NameIndex& TransportCatalogue::GetStopNameIndex() const {
+        return stop_name_index_;
+    }
+
+    const NameIndex& TransportCatalogue::GetBusNameIndex() const {
+        return bus_name_index_;
+    }
+
+    uint64_t TransportCatalogue::GetVersion() const {
+        return version_;
+    }
+
+    size_t TransportCatalogue::EstimateRouterTableBytes() const {
+        return TransportRouter::EstimateTableBytes(stop_name_to_stop_.size());
+    }
 }
\ No newline at end of file
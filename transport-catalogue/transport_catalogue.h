@@ -1,13 +1,19 @@
 #pragma once
 
+#include "arena.h"
 #include "domain.h"
 #include "graph.h"
+#include "memory_usage.h"
+#include "name_index.h"
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <set>
 #include <deque>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <vector>
 #include <memory>
 #include "router.h"
@@ -19,11 +25,14 @@ namespace transport {
     class TransportRouter;
     struct RouteInfo;
 
-    using stops_map = std::unordered_map<std::string_view, const Stop*>;
-    using buses_map = std::unordered_map<std::string_view, const Bus *>;
-    using buses_names_on_stop_map = std::unordered_map<std::string_view, std::set<std::string_view> >;
-    using set_names = const std::set<std::string_view> *;
-    using map_distances = std::unordered_map<std::pair<const Stop *, const Stop *>, int, StopPairHasher>;
+    // Индексы держат изменяемые указатели: delta-операции правят объекты на месте
+    using stops_map = std::pmr::unordered_map<std::string_view, Stop*>;
+    using buses_map = std::pmr::unordered_map<std::string_view, Bus*>;
+    using buses_names_on_stop_map = std::pmr::unordered_map<std::string_view, std::pmr::set<std::string_view> >;
+    using set_names = const std::pmr::set<std::string_view> *;
+    using map_distances = std::pmr::unordered_map<std::pair<const Stop *, const Stop *>, int, StopPairHasher>;
+    using stops_storage = std::pmr::deque<Stop>;
+    using buses_storage = std::pmr::deque<Bus>;
 
     class TransportCatalogue {
     public:
@@ -37,30 +46,95 @@ namespace transport {
             double curvature = 1.0;
         };
 
-        void AddStop(std::string, geo::Coordinates);
+        // Производные структуры, которые нужно перестроить после изменения каталога
+        struct Invalidation {
+            bool router = false;
+            bool map = false;
+            bool name_index = false;
+
+            Invalidation& operator|=(const Invalidation& other) {
+                router = router || other.router;
+                map = map || other.map;
+                name_index = name_index || other.name_index;
+                return *this;
+            }
+        };
+
+        void AddStop(std::string_view, geo::Coordinates);
         void AddDistance(const Stop *, const Stop *, int);
-        void AddBus(std::string, const std::vector<std::string_view> &, bool);
+        void AddBus(std::string_view, std::span<const std::string_view>, bool);
+
+        Invalidation UpsertStop(std::string_view, geo::Coordinates);
+        Invalidation RemoveStop(std::string_view);
+        Invalidation UpsertBus(std::string_view, std::span<const std::string_view>, bool);
+        Invalidation RemoveBus(std::string_view);
+        Invalidation SetDistance(std::string_view, std::string_view, int);
 
         [[nodiscard]] const Stop *FindStop(std::string_view) const;
         [[nodiscard]] const Bus *FindBus(std::string_view) const;
         [[nodiscard]] std::optional<set_names> GetBusesByStopName(std::string_view) const;
         [[nodiscard]] std::optional<BusInfo> GetBusInfo(std::string_view) const;
         [[nodiscard]] std::set<std::string_view> GetBusNames() const;
-        const std::deque<Stop>& GetStops() const;
-        const std::deque<Bus>& GetBuses() const;
+        // Содержат и удалённые элементы: актуален только тот, что возвращает FindStop/FindBus по его имени
+        const stops_storage& GetStops() const;
+        const buses_storage& GetBuses() const;
         std::optional<int> GetDistance(const Stop *lhs, const Stop *rhs) const;
+        const map_distances& GetDistances() const;
         void SetRoutingSettings(int bus_wait_time, double bus_velocity);
         void BuildRouter();
-        std::optional<RouteInfo> FindRoute(const std::string& from, const std::string& to) const;
+        // Число и объём выделений в арене каталога
+        [[nodiscard]] AllocationStats GetAllocationStats() const;
+
+        struct MemoryStats {
+            memory::Usage stops;
+            memory::Usage buses;
+            memory::Usage bus_stops;
+            memory::Usage names;
+            memory::Usage stop_index;
+            memory::Usage bus_index;
+            memory::Usage stop_buses;
+            memory::Usage distances;
+            // Удалённые остановки и автобусы, которые остаются в хранилище
+            memory::Usage retired;
+        };
+
+        [[nodiscard]] MemoryStats GetMemoryStats() const;
+        [[nodiscard]] const TransportRouter& GetRouter() const;
+
+        // Строит индексы имён для поиска по префиксу; вызывается после загрузки и изменений каталога
+        void BuildNameIndex();
+        [[nodiscard]] const NameIndex& GetStopNameIndex() const;
+        [[nodiscard]] const NameIndex& GetBusNameIndex() const;
+        // Растёт при каждом изменении каталога; по нему проверяются производные кэши
+        [[nodiscard]] uint64_t GetVersion() const;
+        // Прогноз объёма таблицы маршрутизатора до вызова BuildRouter
+        [[nodiscard]] size_t EstimateRouterTableBytes() const;
+        std::optional<RouteInfo> FindRoute(std::string_view from, std::string_view to) const;
 
     private:
-        std::deque<Stop> stops_;
-        std::deque<Bus> buses_;
+        void AttachBusToStops(Bus& bus, std::span<const std::string_view> stop_names);
+        void DetachBusFromStops(const Bus& bus);
+        void ReleaseRoute(Bus& bus);
+
+        // Арена объявлена первой: она должна пережить все размещённые в ней контейнеры
+        Arena arena_;
+        // Узлы индексов и массивы остановок маршрутов, которые delta-операции освобождают
+        // и выделяют заново: пул поверх арены переиспользует освобождённые блоки
+        std::pmr::unsynchronized_pool_resource pool_;
+        stops_storage stops_;
+        buses_storage buses_;
         stops_map stop_name_to_stop_;
         buses_map bus_name_to_bus_;
         buses_names_on_stop_map stop_name_to_buses_;
-        std::set<std::string_view> empty_buses_set_;
+        std::pmr::set<std::string_view> empty_buses_set_;
         map_distances distances_between_stops_;
+        // Удалённые по имени; при повторном добавлении их имена и объекты автобусов переиспользуются
+        stops_map retired_stops_;
+        buses_map retired_buses_;
+        std::vector<const Stop*> route_buffer_;
+        NameIndex stop_name_index_;
+        NameIndex bus_name_index_;
         TransportRouter* router_;
+        uint64_t version_ = 0;
     };
 }
@@ -14,6 +14,7 @@ void transport::TransportRouter::BuildGraph(const transport::TransportCatalogue&
     // Создаем вершины для остановок
     graph::VertexId vertex_id = 0;
     for (const auto& stop : catalogue.GetStops()) {
+        if (stop.retired) continue;
         stop_to_wait_vertex_[stop.name] = vertex_id++;
         stop_to_bus_vertex_[stop.name] = vertex_id++;
     }
@@ -32,13 +33,13 @@ void transport::TransportRouter::BuildGraph(const transport::TransportCatalogue&
     // Добавляем ребра автобусных переездов
     for (const auto& bus : catalogue.GetBuses()) {
         const auto& stops = bus.stops;
-        if (stops.empty()) continue;
+        if (stops.empty() || bus.retired) continue;
 
         // Обрабатываем все возможные пары остановок в маршруте
         for (size_t i = 0; i < stops.size(); ++i) {
             for (size_t j = i + 1; j < stops.size(); ++j) {
-                const std::string& from_stop = stops[i]->name;
-                const std::string& to_stop = stops[j]->name;
+                const std::string_view from_stop = stops[i]->name;
+                const std::string_view to_stop = stops[j]->name;
 
                 // Вычисляем общее расстояние и время
                 int total_distance = 0;
@@ -81,7 +82,7 @@ void transport::TransportRouter::BuildGraph(const transport::TransportCatalogue&
 }
 
 std::optional<transport::RouteInfo> transport::TransportRouter::FindRoute(
-    const std::string& from, const std::string& to) const
+    std::string_view from, std::string_view to) const
 {
     if (!stop_to_wait_vertex_.count(from) || !stop_to_wait_vertex_.count(to)) {
         return std::nullopt;
@@ -103,11 +104,35 @@ std::optional<transport::RouteInfo> transport::TransportRouter::FindRoute(
         const auto& [bus_name, from_stop, span_count] = edge_info_.at(edge_id);
 
         if (bus_name == "WAIT") { // Ребро ожидания
-            result.items.emplace_back(std::pair{from_stop, edge.weight});
+            result.items.emplace_back(std::pair{std::string(from_stop), edge.weight});
         } else { // Ребро автобуса
-            result.items.emplace_back(std::tuple{bus_name, from_stop, span_count, edge.weight});
+            result.items.emplace_back(std::tuple{std::string(bus_name), std::string(from_stop), span_count, edge.weight});
         }
     }
 
     return result;
+}
+
+transport::TransportRouter::MemoryStats transport::TransportRouter::GetMemoryStats() const {
+    MemoryStats stats;
+    if (graph_) {
+        const size_t vertex_count = graph_->GetVertexCount();
+        const size_t edge_count = graph_->GetEdgeCount();
+        // Рёбра и списки инцидентности: каждое ребро учтено в списке своей начальной вершины
+        stats.graph.elements = edge_count;
+        stats.graph.bytes = edge_count * (sizeof(graph::Edge<double>) + sizeof(graph::EdgeId))
+                          + vertex_count * sizeof(std::vector<graph::EdgeId>);
+    }
+    if (router_) {
+        stats.table.elements = graph_->GetVertexCount() * graph_->GetVertexCount();
+        stats.table.bytes = graph::Router<double>::EstimateTableBytes(graph_->GetVertexCount());
+    }
+    stats.edge_info = memory::ForHashTable(edge_info_);
+    stats.vertex_index = memory::ForHashTable(stop_to_wait_vertex_);
+    stats.vertex_index += memory::ForHashTable(stop_to_bus_vertex_);
+    return stats;
+}
+
+size_t transport::TransportRouter::EstimateTableBytes(size_t stop_count) {
+    return graph::Router<double>::EstimateTableBytes(stop_count * 2);
 }
\ No newline at end of file
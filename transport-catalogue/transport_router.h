@@ -3,10 +3,12 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 #include "graph.h"
+#include "memory_usage.h"
 #include "router.h"
 #include "transport_catalogue.h"
 
@@ -33,16 +35,28 @@ namespace transport {
             double bus_velocity = 0;
         };
 
+        struct MemoryStats {
+            memory::Usage graph;
+            memory::Usage table;
+            memory::Usage edge_info;
+            memory::Usage vertex_index;
+        };
+
         void SetRoutingSettings(int bus_wait_time, double bus_velocity);
         void BuildGraph(const transport::TransportCatalogue& catalogue);
-        std::optional<transport::RouteInfo> FindRoute(const std::string& from, const std::string& to) const;
+        std::optional<transport::RouteInfo> FindRoute(std::string_view from, std::string_view to) const;
+
+        [[nodiscard]] MemoryStats GetMemoryStats() const;
+        // Объём таблицы маршрутизатора для stop_count остановок (по две вершины на остановку)
+        static size_t EstimateTableBytes(size_t stop_count);
 
     private:
         RoutingSettings routing_settings_;
         std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_;
         std::unique_ptr<graph::Router<double>> router_;
-        std::unordered_map<std::string, graph::VertexId> stop_to_wait_vertex_;
-        std::unordered_map<std::string, graph::VertexId> stop_to_bus_vertex_;
-        std::unordered_map<graph::EdgeId, std::tuple<std::string, std::string, int>> edge_info_;
+        // Имена указывают в арену каталога и живут, пока жив каталог
+        std::unordered_map<std::string_view, graph::VertexId> stop_to_wait_vertex_;
+        std::unordered_map<std::string_view, graph::VertexId> stop_to_bus_vertex_;
+        std::unordered_map<graph::EdgeId, std::tuple<std::string_view, std::string_view, int>> edge_info_;
     };
 }
\ No newline at end of file